@@ -0,0 +1,396 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <ctime>
+#include "options.h"
+#include "literals.h"
+
+/*******************************************************************************************************************
+edusat-check: a DRAT and LRAT proof checker.
+Usage: edusat-check [-lrat] <cnf file> <proof file>. A DRAT proof may be binary (as written by edusat -proof) or text.
+A (text) LRAT proof is checked forward and linearly: each lemma is checked on its hints only (see ProofWriter).
+
+Backward checking: a forward pass applies the proof up to the first empty clause (or the point where unit
+propagation refutes the clause DB). Then the proof is undone step by step from there, and only lemmas in the
+core - the clauses that took part in refuting a later lemma - are checked: each by RUP (assign its negation,
+propagate, expect a conflict), or, failing that, by RAT on its first literal.
+Propagation is core-first: non-core clauses are used only when the core clauses imply nothing more,
+which keeps the core, and hence the number of checked lemmas, small.
+As in drat-trim, deletions of unit clauses are ignored.
+********************************************************************************************************************/
+
+unordered_map<string, option*> options; // none: options.cpp (for Abort()) refers to the map
+
+struct ClauseHash {
+	size_t operator()(const clause_t& c) const {
+		size_t h = c.size();
+		for (clause_t::const_iterator it = c.begin(); it != c.end(); ++it) h = h * 1000003 + *it;
+		return h;
+	}
+};
+
+class Checker {
+	vector<clause_t> clauses;          // input clauses, then lemmas. Literals as in edusat (see v2l()).
+	vector<bool> active, core;
+	vector<int> units;                 // ids of the clauses of size 1, which are not watched
+	vector<pair<bool, int> > steps;    // the proof: (deletion?, clause id)
+	int num_input;
+	vector<vector<int> > watches;      // Lit => clauses watching it (positions 0 and 1). Stale entries are dropped on visit.
+	vector<char> val;                  // Lit => 1 (true), -1 (false), 0 (unassigned)
+	vector<int> reason;                // Var => clause that implied it, -1 for the negated lemma
+	vector<bool> seen;
+	trail_t trail;
+	unsigned int nvars;
+	int num_checked, num_rat, num_ignored;
+
+	bool is_true(Lit l) { return val[l] > 0; }
+	bool is_false(Lit l) { return val[l] < 0; }
+	void assign(Lit l, int r) { val[l] = 1; val[lit_negate(l)] = -1; reason[l2v(l)] = r; trail.push_back(l); }
+	void watch(int id);
+	void add_lit(clause_t& c, int i);
+	int  visit(Lit false_lit, bool core_mode);
+	int  propagate();
+	void mark_core(int conflict, Lit conflict_lit);
+	bool rup(const clause_t& lemma);
+	bool rat(int id);
+
+public:
+	Checker() : num_input(0), nvars(0), num_checked(0), num_rat(0), num_ignored(0) {}
+	void read_cnf(ifstream& in);
+	void read_proof(ifstream& in);
+	bool check();
+	bool check_lrat(ifstream& in);
+};
+
+// Appends DIMACS literal i to c, unless it is already there. 
+void Checker::add_lit(clause_t& c, int i) {
+	if (Abs(i) > nvars) {
+		nvars = Abs(i);
+		val.resize(2 * nvars + 2, 0);
+		watches.resize(2 * nvars + 2);
+		reason.resize(nvars + 1, -1);
+		seen.resize(nvars + 1, false);
+	}
+	if (find(c.begin(), c.end(), v2l(i)) == c.end()) c.push_back(v2l(i));
+}
+
+void Checker::watch(int id) {
+	clause_t& c = clauses[id];
+	if (c.size() == 1) units.push_back(id);
+	if (c.size() < 2) return;
+	watches[c[0]].push_back(id);
+	watches[c[1]].push_back(id);
+}
+
+void Checker::read_cnf(ifstream& in) {
+	string line;
+	clause_t c;
+	int i;
+	while (in.peek() == 'c' || in.peek() == 'p') getline(in, line);
+	while (in >> i) {
+		if (i) { add_lit(c, i); continue; }
+		clauses.push_back(c);
+		c.clear();
+	}
+	num_input = static_cast<int>(clauses.size());
+	cout << "c " << num_input << " input clauses, " << nvars << " variables" << endl;
+}
+
+// Binary if any of the first bytes cannot appear in a text proof.
+void Checker::read_proof(ifstream& in) {
+	string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	bool binary = false;
+	for (size_t k = 0; k < data.size() && k < 256 && !binary; ++k) {
+		char ch = data[k];
+		if (!isdigit(ch) && !isspace(ch) && ch != '-' && ch != 'd' && ch != 'c') binary = true;
+	}
+	unordered_map<clause_t, vector<int>, ClauseHash> ids; // sorted literals => ids of the live copies
+	for (int id = 0; id < num_input; ++id) {
+		clause_t key = clauses[id];
+		sort(key.begin(), key.end());
+		ids[key].push_back(id);
+	}
+	size_t pos = 0;
+	istringstream text(binary ? string() : data);
+	while (true) {
+		bool del = false;
+		clause_t c;
+		if (binary) {
+			if (pos >= data.size()) break;
+			char tag = data[pos++];
+			if (tag != 'a' && tag != 'd') Abort("bad binary proof line", 1);
+			del = (tag == 'd');
+			while (true) {
+				unsigned int u = 0, shift = 0;
+				unsigned char b;
+				do {
+					if (pos >= data.size()) Abort("truncated binary proof", 1);
+					b = static_cast<unsigned char>(data[pos++]);
+					u |= (b & 127u) << shift;
+					shift += 7;
+				} while (b & 128);
+				if (!u) break;
+				add_lit(c, (u & 1) ? -static_cast<int>(u >> 1) : static_cast<int>(u >> 1));
+			}
+		}
+		else {
+			string tok;
+			if (!(text >> tok)) break;
+			if (tok == "c") { getline(text, tok); continue; }
+			if (tok == "d") {
+				del = true;
+				if (!(text >> tok)) break;
+			}
+			for (int i = stoi(tok); i; ) {
+				add_lit(c, i);
+				if (!(text >> i)) Abort("truncated text proof", 1);
+			}
+		}
+		clause_t key = c;
+		sort(key.begin(), key.end());
+		if (!del) {
+			ids[key].push_back(static_cast<int>(clauses.size()));
+			steps.push_back(make_pair(false, static_cast<int>(clauses.size())));
+			clauses.push_back(c);
+			continue;
+		}
+		if (c.size() == 1) { ++num_ignored; continue; } // as drat-trim: unit deletions are ignored
+		unordered_map<clause_t, vector<int>, ClauseHash>::iterator it = ids.find(key);
+		if (it == ids.end() || it->second.empty()) { ++num_ignored; continue; } // deleting a missing clause
+		steps.push_back(make_pair(true, it->second.back()));
+		it->second.pop_back();
+	}
+	cout << "c " << steps.size() << " proof steps (" << (binary ? "binary" : "text") << ")" << endl;
+}
+
+// Visits the clauses watching false_lit, in the given mode (core or non-core clauses). Returns a conflicting clause or -1.
+int Checker::visit(Lit false_lit, bool core_mode) {
+	vector<int>& ws = watches[false_lit];
+	size_t i = 0, j = 0;
+	int conflict = -1;
+	for (; i < ws.size(); ++i) {
+		int id = ws[i];
+		clause_t& c = clauses[id];
+		if (!active[id] || (c[0] != false_lit && c[1] != false_lit)) continue; // stale
+		if (core[id] != core_mode || conflict >= 0) { ws[j++] = id; continue; }
+		if (c[0] == false_lit) swap(c[0], c[1]);
+		if (is_true(c[0])) { ws[j++] = id; continue; }
+		size_t k = 2;
+		for (; k < c.size() && is_false(c[k]); ++k);
+		if (k < c.size()) { // a new watch
+			swap(c[1], c[k]);
+			watches[c[1]].push_back(id);
+			continue;
+		}
+		ws[j++] = id;
+		if (is_false(c[0])) conflict = id;
+		else assign(c[0], id);
+	}
+	ws.resize(j);
+	return conflict;
+}
+
+// Core-first unit propagation. Returns a conflicting clause or -1.
+int Checker::propagate() {
+	size_t head_core = 0, head_all = 0;
+	while (true) {
+		int conflict = -1;
+		if (head_core < trail.size()) conflict = visit(lit_negate(trail[head_core++]), true);
+		else if (head_all < trail.size()) conflict = visit(lit_negate(trail[head_all++]), false);
+		else return -1;
+		if (conflict >= 0) return conflict;
+	}
+}
+
+// Adds the clauses used to derive the conflict to the core. The conflict is a clause, or (if conflict == -1)
+// the variable of conflict_lit, which was assigned both ways.
+void Checker::mark_core(int conflict, Lit conflict_lit) {
+	if (conflict >= 0) {
+		core[conflict] = true;
+		for (clause_it it = clauses[conflict].begin(); it != clauses[conflict].end(); ++it) seen[l2v(*it)] = true;
+	}
+	else seen[l2v(conflict_lit)] = true;
+	for (trail_t::reverse_iterator t = trail.rbegin(); t != trail.rend(); ++t) {
+		Var v = l2v(*t);
+		if (!seen[v]) continue;
+		seen[v] = false;
+		int r = reason[v];
+		if (r < 0) continue;
+		core[r] = true;
+		for (clause_it it = clauses[r].begin(); it != clauses[r].end(); ++it) seen[l2v(*it)] = true;
+	}
+}
+
+bool Checker::rup(const clause_t& lemma) {
+	for (trail_t::iterator t = trail.begin(); t != trail.end(); ++t) val[*t] = val[lit_negate(*t)] = 0;
+	trail.clear();
+	bool refuted = false;
+	for (vector<int>::iterator u = units.begin(); u != units.end() && !refuted; ++u) {
+		if (!active[*u]) continue;
+		Lit l = clauses[*u][0];
+		if (is_false(l)) { mark_core(*u, 0); refuted = true; }
+		else if (!is_true(l)) assign(l, *u);
+	}
+	for (clause_t::const_iterator it = lemma.begin(); it != lemma.end() && !refuted; ++it) {
+		if (is_true(*it)) { mark_core(-1, *it); refuted = true; }
+		else if (!is_false(*it)) assign(lit_negate(*it), -1);
+	}
+	if (!refuted) {
+		int conflict = propagate();
+		if (conflict >= 0) { mark_core(conflict, 0); refuted = true; }
+	}
+	return refuted;
+}
+
+// RAT on the first literal p of the lemma: every resolvent with an active clause containing ~p is RUP.
+bool Checker::rat(int id) {
+	clause_t lemma = clauses[id];
+	if (lemma.empty()) return false;
+	Lit p = lemma[0];
+	for (int d = 0; d < static_cast<int>(clauses.size()); ++d) {
+		if (!active[d] || find(clauses[d].begin(), clauses[d].end(), lit_negate(p)) == clauses[d].end()) continue;
+		clause_t resolvent = lemma;
+		for (clause_it it = clauses[d].begin(); it != clauses[d].end(); ++it)
+			if (*it != lit_negate(p) && find(resolvent.begin(), resolvent.end(), *it) == resolvent.end()) resolvent.push_back(*it);
+		if (!rup(resolvent)) return false;
+		core[d] = true;
+	}
+	++num_rat;
+	return true;
+}
+
+bool Checker::check() {
+	active.assign(clauses.size() + 1, false);
+	core.assign(clauses.size() + 1, false);
+	for (int id = 0; id < num_input; ++id) {
+		if (clauses[id].empty()) return true; // the input has an empty clause
+		active[id] = true;
+		watch(id);
+	}
+	// forward: up to the first empty clause
+	int end = -1;
+	for (int s = 0; s < static_cast<int>(steps.size()) && end < 0; ++s) {
+		int id = steps[s].second;
+		if (steps[s].first) { active[id] = false; continue; }
+		active[id] = true;
+		watch(id);
+		if (clauses[id].empty()) end = s;
+	}
+	if (end < 0) { // no empty clause: it must follow from the final clause DB by unit propagation
+		clauses.push_back(clause_t());
+		steps.push_back(make_pair(false, static_cast<int>(clauses.size()) - 1));
+		end = static_cast<int>(steps.size()) - 1;
+	}
+	core[steps[end].second] = true;
+	// backward
+	for (int s = end; s >= 0; --s) {
+		int id = steps[s].second;
+		if (steps[s].first) { active[id] = true; watch(id); continue; }
+		active[id] = false;
+		if (!core[id]) continue;
+		++num_checked;
+		if (rup(clauses[id]) || rat(id)) continue;
+		cout << "c lemma " << s << " failed:";
+		for (clause_it it = clauses[id].begin(); it != clauses[id].end(); ++it) cout << " " << l2rl(*it);
+		cout << endl;
+		return false;
+	}
+	int core_input = 0, lemmas = 0;
+	for (int id = 0; id < num_input; ++id) if (core[id]) ++core_input;
+	for (int s = 0; s <= end; ++s) if (!steps[s].first) ++lemmas;
+	cout << "c " << num_checked << " of " << lemmas << " lemmas checked (" << num_rat << " RAT), "
+		 << core_input << " of " << num_input << " input clauses in the core, " << num_ignored << " deletions ignored" << endl;
+	return true;
+}
+
+/* Forward LRAT check. Clause id i <= num_input is input clause i - 1. For each lemma, its negation is assigned and 
+each hint must then be unit, and the last one falsified. RAT hints (negative ids) are not supported. */
+bool Checker::check_lrat(ifstream& in) {
+	unordered_map<int, clause_t> lemmas;
+	vector<bool> deleted(num_input + 1, false);
+	int num_lemmas = 0, num_deleted = 0;
+	string line;
+	while (getline(in, line)) {
+		istringstream ls(line);
+		string tok;
+		int id, i;
+		if (!(ls >> id)) continue; // blank line or comment
+		if (!(ls >> tok)) Abort("truncated LRAT line", 1);
+		if (tok == "d") {
+			while (true) {
+				if (!(ls >> i)) Abort("truncated LRAT line", 1);
+				if (!i) break;
+				if (i <= num_input) deleted[i] = true;
+				else lemmas.erase(i);
+				++num_deleted;
+			}
+			continue;
+		}
+		clause_t lemma;
+		istringstream first(tok);
+		if (!(first >> i) || !first.eof()) Abort("bad LRAT line", 1);
+		while (i) {
+			add_lit(lemma, i);
+			if (!(ls >> i)) Abort("truncated LRAT line", 1);
+		}
+		for (trail_t::iterator t = trail.begin(); t != trail.end(); ++t) val[*t] = val[lit_negate(*t)] = 0;
+		trail.clear();
+		bool tautology = false;
+		for (clause_it it = lemma.begin(); it != lemma.end(); ++it) {
+			if (is_true(*it)) tautology = true;
+			else if (!is_false(*it)) assign(lit_negate(*it), -1);
+		}
+		bool refuted = tautology;
+		while (true) {
+			if (!(ls >> i)) Abort("truncated LRAT line", 1);
+			if (!i) break;
+			if (refuted) continue; // hints after the conflict are not needed
+			clause_t* c = nullptr;
+			if (i > 0 && i <= num_input && !deleted[i]) c = &clauses[i - 1];
+			else if (i > num_input && lemmas.count(i)) c = &lemmas[i];
+			if (!c) { cout << "c lemma " << id << ": hint " << i << " is not an active clause" << endl; return false; }
+			Lit unit = 0;
+			int unassigned = 0;
+			for (clause_it it = c->begin(); it != c->end(); ++it) {
+				if (is_true(*it)) { unassigned = 2; break; }
+				if (!is_false(*it)) { unit = *it; ++unassigned; }
+			}
+			if (unassigned > 1) { cout << "c lemma " << id << ": hint " << i << " is not unit" << endl; return false; }
+			if (unassigned == 0) refuted = true;
+			else assign(unit, -1);
+		}
+		if (!refuted) { cout << "c lemma " << id << ": the hints do not refute it" << endl; return false; }
+		++num_lemmas;
+		if (lemma.empty()) {
+			cout << "c " << num_lemmas << " lemmas checked, " << num_deleted << " deletions" << endl;
+			return true;
+		}
+		lemmas[id] = lemma;
+	}
+	cout << "c no empty clause in the proof" << endl;
+	return false;
+}
+
+int main(int argc, char** argv) {
+	clock_t start = clock();
+	bool lrat = argc == 4 && string(argv[1]) == "-lrat";
+	if (argc != 3 && !lrat) Abort("Usage: edusat-check [-lrat] <cnf file> <proof file>", 2);
+	ifstream cnf_in(argv[argc - 2]), proof_in(argv[argc - 1], ios::binary);
+	if (!cnf_in.good()) Abort("cannot read input file", 1);
+	if (!proof_in.good()) Abort("cannot read proof file", 1);
+	Checker C;
+	C.read_cnf(cnf_in);
+	bool ok;
+	if (lrat) ok = C.check_lrat(proof_in);
+	else {
+		C.read_proof(proof_in);
+		ok = C.check();
+	}
+	cout << "c time: " << (double)(clock() - start) / CLOCKS_PER_SEC << " secs" << endl;
+	cout << (ok ? "s VERIFIED" : "s NOT VERIFIED") << endl;
+	return ok ? 0 : 1;
+}
@@ -1,7 +1,5 @@
 #include "edusat.h"
-
-
-Solver S;
+#include "ipasir.h"
 
 using namespace std;
 
@@ -14,20 +12,20 @@ inline bool verbose_now() {
 
 /******************  Reading the CNF ******************************/
 #pragma region readCNF
-void skipLine(ifstream& in) {
+void skipLine(istream& in) {
 	for (;;) {
 		//if (in.get() == EOF || in.get() == '\0') return;
 		if (in.get() == '\n') { return; }
 	}
 }
 
-static void skipWhitespace(ifstream& in, char&c) {
+static void skipWhitespace(istream& in, char&c) {
 	c = in.get();
 	while ((c >= 9 && c <= 13) || c == 32)
 		c = in.get();
 }
 
-static int parseInt(ifstream& in) {
+static int parseInt(istream& in) {
 	int     val = 0;
 	bool    neg = false;
 	char c;
@@ -40,7 +38,8 @@ static int parseInt(ifstream& in) {
 	return neg ? -val : val;
 }
 
-void Solver::read_cnf(ifstream& in) {
+// For iCNF input (`p inccnf') the clauses and queries are then read by solve_icnf(). WCNF input is read completely. 
+InputFormat Solver::read_cnf(istream& in) {
 	int i;
 	unsigned int vars, clauses, unary = 0;
 	set<Lit> s;
@@ -49,22 +48,49 @@ void Solver::read_cnf(ifstream& in) {
 
 	while (in.peek() == 'c') skipLine(in);
 
-	if (!match(in, "p cnf")) Abort("Expecting `p cnf' in the beginning of the input file", 1);
+	if (in.peek() == 'h' || isdigit(in.peek())) { // WCNF without a header
+		read_wcnf(in, false);
+		return InputFormat::WCNF;
+	}
+	if (!match(in, "p ")) Abort("Expecting `p cnf' in the beginning of the input file", 1);
+	if (in.peek() == 'i') {
+		if (!match(in, "inccnf")) Abort("Expecting `p inccnf' in the beginning of the input file", 1);
+		skipLine(in);
+		initialize();
+		return InputFormat::ICNF;
+	}
+	if (in.peek() == 'w') {
+		if (!match(in, "wcnf")) Abort("Expecting `p wcnf' in the beginning of the input file", 1);
+		read_wcnf(in, true);
+		return InputFormat::WCNF;
+	}
+	if (!match(in, "cnf")) Abort("Expecting `p cnf' in the beginning of the input file", 1);
 	in >> vars; // since vars is int, it reads int from the stream.
 	in >> clauses;
 	if (!vars || !clauses) Abort("Expecting non-zero variables and clauses", 1);
 	cout << "vars: " << vars << " clauses: " << clauses << endl;
 	cnf.reserve(clauses);
 
-	set_nvars(vars);
 	set_nclauses(clauses);
-	initialize();
+	if (compact_vars) { // variables are allocated as they appear; the others are not in the solver at all
+		initialize();
+		ext2int.resize(vars + 1, 0);
+	}
+	else {
+		set_nvars(vars);
+		initialize();
+	}
 
 	while (in.good() && in.peek() != EOF) {
 		i = parseInt(in);
 		if (i == 0) {
 			c.cl().resize(s.size());
 			copy(s.begin(), s.end(), c.cl().begin());
+			c.set_id(++last_id);
+			if (!core_file.empty()) { // keep a copy: simplify() changes the clauses in place
+				input_clauses.push_back(vector<int>());
+				for (clause_it it = c.cl().begin(); it != c.cl().end(); ++it) input_clauses.back().push_back(lit2ext(*it));
+			}
 			switch (c.size()) {
 			case 0: {
 				stringstream num;  // this allows to convert int to string
@@ -77,9 +103,15 @@ void Solver::read_cnf(ifstream& in) {
 				// add a check in BCP. 
 				if (state[l2v(l)] != VarState::V_UNASSIGNED)
 					if (Neg(l) != (state[l2v(l)] == VarState::V_FALSE)) {
-						S.print_stats();
-						Abort("UNSAT (conflicting unaries for var " + to_string(l2v(l)) +")", 0);
+						if (trace) {
+							int id = proof_add(clause_t(), vector<int>{unit_id[l2v(l)], c.get_id()});
+							if (proof) proof->flush();
+							if (!core_file.empty()) write_core(id);
+						}
+						print_stats();
+						Abort("UNSAT (conflicting unaries for var " + to_string(int2ext[l2v(l)]) +")", 0);
 					}
+				if (!unit_id[l2v(l)]) unit_id[l2v(l)] = c.get_id();
 				assert_lit(l);
 				add_unary_clause(l);
 				break; // unary clause. Note we do not add it as a clause. 
@@ -91,13 +123,203 @@ void Solver::read_cnf(ifstream& in) {
 			continue;
 		}
 		if (Abs(i) > vars) Abort("Literal index larger than declared on the first line", 1);
-		if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) bumpVarScore(abs(i));
-		i = v2l(i);		
+		i = compact_vars ? ext2lit(i) : v2l(i);
+		if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) bumpVarScore(l2v(i));
 		if (ValDecHeuristic == VAL_DEC_HEURISTIC::LITSCORE) bumpLitScore(i);
 		s.insert(i);
 	}	
 	if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) reset_iterators();
+	if (compact_vars) cout << "Variables used: " << nvars << " of " << vars << endl;
 	cout << "Read " << cnf_size() << " clauses in " << cpuTime() - begin_time << " secs." << endl << "Solving..." << endl;
+	return InputFormat::CNF;
+}
+
+// a[perm[v]] = a[v] (the old a[v]) for every variable v >= 1
+template <class T> static void permute_vars(vector<T>& a, const vector<Var>& perm) {
+	vector<T> b(a);
+	for (unsigned int v = 1; v < perm.size(); ++v) b[perm[v]] = a[v];
+	a.swap(b);
+}
+
+/* Renumbers the variables in Cuthill-McKee order, for locality: breadth-first over the variable graph (variables 
+are adjacent if they share a clause) from a variable of minimum degree, visiting the new neighbours of each variable 
+by increasing degree. The degree is approximated by the # of occurrences. Variables that share clauses then get 
+nearby indices, and so do their entries in state, dlevel, antecedent, m_activity and watches. Invoked after read_cnf(); 
+the DIMACS numbers stay in int2ext / ext2int for the output. */
+void Solver::renumber() {
+	vector<vector<int> > occ(nvars + 1);
+	for (unsigned int idx = 0; idx < cnf.size(); ++idx)
+		for (clause_it it = cnf[idx].cl().begin(); it != cnf[idx].cl().end(); ++it) occ[l2v(*it)].push_back(idx);
+	auto by_degree = [&occ](Var a, Var b) { return occ[a].size() < occ[b].size(); };
+	vector<Var> starts, order;
+	for (unsigned int v = 1; v <= nvars; ++v) starts.push_back(v);
+	stable_sort(starts.begin(), starts.end(), by_degree);
+	vector<bool> seen(nvars + 1, false), expanded(cnf.size(), false);
+	for (vector<Var>::iterator s = starts.begin(); s != starts.end(); ++s) {
+		if (seen[*s]) continue;
+		seen[*s] = true;
+		order.push_back(*s);
+		for (unsigned int head = order.size() - 1; head < order.size(); ++head) {
+			unsigned int first = order.size();
+			for (vector<int>::iterator idx = occ[order[head]].begin(); idx != occ[order[head]].end(); ++idx) {
+				if (expanded[*idx]) continue;
+				expanded[*idx] = true;
+				for (clause_it it = cnf[*idx].cl().begin(); it != cnf[*idx].cl().end(); ++it) {
+					if (seen[l2v(*it)]) continue;
+					seen[l2v(*it)] = true;
+					order.push_back(l2v(*it));
+				}
+			}
+			stable_sort(order.begin() + first, order.end(), by_degree);
+		}
+	}
+	vector<Var> perm(nvars + 1, 0); // old => new
+	for (unsigned int i = 0; i < order.size(); ++i) perm[order[i]] = i + 1;
+	auto map_lit = [&perm](Lit l) { return (perm[l2v(l)] << 1) | Neg(l); };
+	for (vector<Clause>::iterator c = cnf.begin(); c != cnf.end(); ++c)
+		for (clause_it it = c->cl().begin(); it != c->cl().end(); ++it) *it = map_lit(*it);
+	for (trail_t::iterator it = trail.begin(); it != trail.end(); ++it) *it = map_lit(*it);
+	for (vector<Lit>::iterator it = unaries.begin(); it != unaries.end(); ++it) *it = map_lit(*it);
+	vector<vector<int> > new_watches(nlits + 2);
+	vector<int> new_score(nlits + 2);
+	vector<LitState> new_val(lit_val);
+	for (unsigned int l = 2; l <= nlits + 1; ++l) {
+		new_watches[map_lit(l)].swap(watches[l]);
+		new_score[map_lit(l)] = LitScore[l];
+		new_val[map_lit(l)] = lit_val[l];
+	}
+	watches.swap(new_watches);
+	LitScore.swap(new_score);
+	lit_val.swap(new_val);
+	permute_vars(state, perm);
+	permute_vars(prev_state, perm);
+#ifdef EDUSAT_SOA
+	permute_vars(antecedent_v, perm);
+	permute_vars(dlevel_v, perm);
+#else
+	permute_vars(var_info, perm);
+#endif
+	permute_vars(unit_id, perm);
+	permute_vars(m_activity, perm);
+	permute_vars(int2ext, perm);
+	for (unsigned int v = 1; v <= nvars; ++v) ext2int[int2ext[v]] = v;
+	m_Score2Vars.clear();
+	for (unsigned int v = 1; v <= nvars; ++v) 
+		if (m_activity[v] > 0) m_Score2Vars[m_activity[v]].insert(v);
+	if (!m_Score2Vars.empty()) reset_iterators();
+}
+
+/* WCNF. Old format: `p wcnf <vars> <clauses> [<top>]', then `<weight> <lits> 0' lines, where a weight >= top 
+marks a hard clause. New format: no header, hard clauses are `h <lits> 0'. Hard clauses go to the clause DB 
+through the incremental interface, which also allocates the variables; soft clauses are kept in soft. */
+void Solver::read_wcnf(istream& in, bool old_format) {
+	long long top = LLONG_MAX, w = 0;
+	if (old_format) {
+		string header;
+		getline(in, header);
+		istringstream hs(header);
+		unsigned int vars, clauses;
+		if (!(hs >> vars >> clauses)) Abort("Expecting `p wcnf <vars> <clauses> [<top>]'", 1);
+		hs >> top;
+		initialize();
+		ext2int.resize(vars + 1, 0); // the model lists all declared variables
+	}
+	else initialize();
+	vector<int> lits;
+	int hard = 0;
+	char c;
+	while (true) {
+		skipWhitespace(in, c);
+		if (!in.good()) break;
+		if (c == 'c') { skipLine(in); continue; }
+		bool is_hard = (c == 'h');
+		if (!is_hard) {
+			in.unget();
+			if (!(in >> w)) Abort("Expecting a weight in the WCNF input", 1);
+			if (w < 0) Abort("Negative weight in the WCNF input", 1);
+			is_hard = old_format && w >= top;
+		}
+		lits.clear();
+		for (int i; (i = parseInt(in)) != 0; ) lits.push_back(i);
+		if (is_hard) {
+			++hard;
+			add_input_clause(lits);
+			continue;
+		}
+		soft.push_back(clause_t());
+		for (vector<int>::iterator it = lits.begin(); it != lits.end(); ++it) soft.back().push_back(ext2lit(*it));
+		soft_weight.push_back(w);
+	}
+	cout << "vars: " << nvars << " hard clauses: " << hard << " soft clauses: " << soft.size() << endl;
+}
+
+// Literals to assume, in DIMACS format, optionally 0-terminated. 
+void Solver::read_assumptions(ifstream& in) {
+	vector<int> lits;
+	int i;
+	while (in.peek() == 'c') skipLine(in);
+	while (in >> i) {
+		if (i == 0) continue;
+		if (Abs(i) >= ext2int.size()) Abort("Assumption literal larger than the number of variables", 1);
+		lits.push_back(i);
+	}
+	if (!in.eof()) Abort("Unexpected char in assumptions file", 1);
+	set_input_assumptions(lits);
+	cout << "Assumptions: " << lits.size() << endl;
+}
+
+void Solver::read_projection(ifstream& in) {
+	vector<bool> seen(ext2int.size(), false);
+	int i;
+	while (in.peek() == 'c') skipLine(in);
+	while (in >> i) {
+		if (Abs(i) >= ext2int.size()) Abort("Projection variable larger than the number of variables", 1);
+		if (i == 0 || seen[Abs(i)]) continue;
+		seen[Abs(i)] = true;
+		project.push_back(l2v(ext2lit(Abs(i)))); // allocated here if it does not occur in the formula (-compact)
+	}
+	if (!in.eof()) Abort("Unexpected char in projection file", 1);
+	cout << "Projection: " << project.size() << " variables" << endl;
+}
+
+/* iCNF: clauses and `a <lits> 0' query lines, streamed. Each query solves the clauses read so far under 
+the given assumptions, keeping the learned clauses, and prints its answer right away: 
+the failed assumptions and S UNSAT, or S SAT and the model as a `v ... 0' line. */
+void Solver::solve_icnf(istream& in) {
+	vector<int> lits;
+	char c;
+	int queries = 0;
+	while (true) {
+		skipWhitespace(in, c);
+		if (!in.good()) break;
+		if (c == 'c') { skipLine(in); continue; }
+		bool query = (c == 'a');
+		if (!query) in.unget();
+		lits.clear();
+		for (int i; (i = parseInt(in)) != 0; ) lits.push_back(i);
+		if (!query) { add_input_clause(lits); continue; }
+		set_input_assumptions(lits);
+		SolverState res = _solve();
+		++queries;
+		switch (res) {
+		case SolverState::SAT:
+			cout << "S SAT" << endl << "v";
+			for (unsigned int v = 1; v < ext2int.size(); ++v)
+				if (model_value(v)) cout << " " << model_value(v);
+			cout << " 0" << endl;
+			break;
+		case SolverState::UNSAT:
+			cout << "Failed assumptions:";
+			for (clause_it it = failed_assumptions.begin(); it != failed_assumptions.end(); ++it) cout << " " << lit2ext(*it);
+			cout << endl << "S UNSAT" << endl;
+			break;
+		default:
+			cout << "S TIMEOUT" << endl;
+			return;
+		}
+	}
+	print_stats();
+	cout << "Queries: " << queries << endl;
 }
 
 #pragma endregion readCNF
@@ -128,33 +350,88 @@ void Solver::initialize() {
 	
 	state.resize(nvars + 1, VarState::V_UNASSIGNED);
 	prev_state.resize(nvars + 1, VarState::V_FALSE); // we set initial assignment with phase-saving to false. 
-	antecedent.resize(nvars + 1, -1);	
-	marked.resize(nvars+1);
-	dlevel.resize(nvars+1);
+	lit_val.resize(2 * nvars + 2, LitState::L_UNASSIGNED);
+	resize_var_info(nvars + 1);
+	unit_id.resize(nvars + 1);
 	
 	nlits = 2 * nvars;
-	watches.resize(nlits + 1);
-	LitScore.resize(nlits + 1);
+	watches.resize(nlits + 2);
+	LitScore.resize(nlits + 2);
 	//initialize scores 	
 	m_activity.resize(nvars + 1);	
 	m_curr_activity = 0.0f;
 	for (unsigned int v = 0; v <= nvars; ++v) {			
 		m_activity[v] = 0;		
 	}
+	ext2int.resize(nvars + 1);
+	int2ext.resize(nvars + 1);
+	for (unsigned int v = 0; v <= nvars; ++v) ext2int[v] = int2ext[v] = v; // the input variables keep their index
 	reset();
 }
 
+void Solver::resize_var_info(unsigned int n) {
+#ifdef EDUSAT_SOA
+	antecedent_v.resize(n, -1);
+	marked_v.resize(n);
+	dlevel_v.resize(n);
+#else
+	var_info.resize(n);
+#endif
+}
+
+// Adds variables up to n (incremental solving). Unlike initialize(), keeps the current assignment and scores. 
+void Solver::grow_vars(unsigned int n) {
+	if (n <= nvars) return;
+	nvars = n;
+	nlits = 2 * nvars;
+	state.resize(nvars + 1, VarState::V_UNASSIGNED);
+	prev_state.resize(nvars + 1, VarState::V_FALSE);
+	lit_val.resize(nlits + 2, LitState::L_UNASSIGNED);
+	resize_var_info(nvars + 1);
+	unit_id.resize(nvars + 1);
+	m_activity.resize(nvars + 1, 0);
+	watches.resize(nlits + 2);
+	LitScore.resize(nlits + 2);
+	int2ext.resize(nvars + 1, 0);
+}
+
+// Allocates a variable for DIMACS variable ext, or an internal one if ext == 0. 
+Var Solver::new_var(int ext) {
+	grow_vars(nvars + 1);
+	int2ext[nvars] = ext;
+	if (ext) {
+		if (ext >= static_cast<int>(ext2int.size())) ext2int.resize(ext + 1, 0);
+		ext2int[ext] = nvars;
+	}
+	return nvars;
+}
+
+Lit Solver::ext2lit(int lit) {
+	int ext = Abs(lit);
+	Var v = ext < static_cast<int>(ext2int.size()) ? ext2int[ext] : 0;
+	if (!v) v = new_var(ext);
+	return v2l(lit < 0 ? -v : v);
+}
+
 inline void Solver::assert_lit(Lit l, int forced_level) {
 	trail.push_back(l);
 	int var = l2v(l);
 	int level = forced_level >= 0 ? forced_level : dl;
 	if (Neg(l)) prev_state[var] = state[var] = VarState::V_FALSE; else prev_state[var] = state[var] = VarState::V_TRUE;
-	dlevel[var] = level;
+	lit_val[l] = LitState::L_SAT;
+	lit_val[lit_negate(l)] = LitState::L_UNSAT;
+	dlevel(var) = level;
+	if (!level) ++num_root_lits;
 	++num_assignments;
-	if (verbose_now()) cout << l2rl(l) <<  " @ " << level << endl;
+	if (verbose_now()) cout << lit_name(l) <<  " @ " << level << endl;
 }
 
 
+inline void Solver::unassign(Var v) {
+	state[v] = VarState::V_UNASSIGNED;
+	lit_val[v2l(v)] = lit_val[v2l(-v)] = LitState::L_UNASSIGNED;
+}
+
 void Solver::m_rescaleScores(double& new_score) {
 	if (verbose_now()) cout << "Rescale" << endl;
 	new_score /= Rescale_threshold;
@@ -207,8 +484,8 @@ void Solver::add_clause(Clause& c, int l, int r) {
 	// the watches should be different. 
 	Assert(l != r);
 	Assert(c.lit(l) != c.lit(r));
-	Assert(c.lit(l) > 0 && c.lit(l) <= nlits);
-	Assert(c.lit(r) > 0 && c.lit(r) <= nlits);
+	Assert(c.lit(l) > 1 && c.lit(l) <= nlits + 1);
+	Assert(c.lit(r) > 1 && c.lit(r) <= nlits + 1);
 	c.lw_set(l);
 	c.rw_set(r);
 	int loc = static_cast<int>(cnf.size());  // the first is in location 0 in cnf	
@@ -223,8 +500,24 @@ void Solver::add_unary_clause(Lit l) {
 	unaries.push_back(l);
 }
 
+// Removes the clause from the watch lists of its two watched literals. 
+void Solver::detach_clause(int idx) {
+	Clause& c = cnf[idx];
+	for (int zo = 0; zo <= 1; ++zo) {
+		vector<int>& wl = watches[zo ? c.get_rw_lit() : c.get_lw_lit()];
+		wl.erase(std::remove(wl.begin(), wl.end(), idx), wl.end());
+	}
+}
+
+// Deletes a clause from the DB. Must not be the antecedent of an assigned variable above level 0. 
+void Solver::remove_clause(int idx) {
+	detach_clause(idx);
+	cnf[idx].mark_deleted();
+}
+
+template <class Cfg>
 int Solver :: getVal(Var v) {
-	switch (ValDecHeuristic) {
+	switch (Cfg::val_dh) {
 	case VAL_DEC_HEURISTIC::PHASESAVING: {
 		VarState saved_phase = prev_state[v];		
 		switch (saved_phase) {
@@ -244,16 +537,42 @@ int Solver :: getVal(Var v) {
 	return 0;
 }
 
+void Solver::new_decision_level() {
+	dl++; // increase decision level
+	if (dl > max_dl) max_dl = dl;
+	// Ensure separators/conflicts_at_dl are large enough (CB backtracking may have shrunk them).
+	// Check each vector independently: recompute_separators() sizes separators to dl+2 but
+	// only fills conflicts_at_dl up to dl+1, so they can be out of sync.
+	if (static_cast<int>(separators.size()) <= dl)
+		separators.resize(dl + 1, static_cast<int>(trail.size()));
+	if (static_cast<int>(conflicts_at_dl.size()) <= dl)
+		conflicts_at_dl.resize(dl + 1, num_learned);
+	separators[dl] = trail.size();
+	conflicts_at_dl[dl] = num_learned;
+}
+
+template <class Cfg>
 SolverState Solver::decide(){
 	if (verbose_now()) cout << "decide" << endl;
 	Lit best_lit = 0;	
-	int max_score = 0;
-	Var bestVar = 0;
-	switch (VarDecHeuristic) {
+	// Assumptions are decided first, one per level. A level whose assumption already holds is left empty. 
+	while (dl < static_cast<int>(assumptions.size())) {
+		Lit a = assumptions[dl];
+		switch (lit_state(a)) {
+		case LitState::L_SAT: new_decision_level(); continue;
+		case LitState::L_UNSAT: analyze_final(a); return SolverState::UNSAT; // UNSAT under the assumptions
+		default: best_lit = a; goto Apply_decision;
+		}
+	}
+	// Projected model enumeration: the projection variables are decided before all others. 
+	for (vector<Var>::iterator it = project.begin(); it != project.end(); ++it)
+		if (state[*it] == VarState::V_UNASSIGNED) { best_lit = getVal<Cfg>(*it); goto Apply_decision; }
+	switch (Cfg::var_dh) {
 
 	case  VAR_DEC_HEURISTIC::MINISAT: {
 		// m_Score2Vars_r_it and m_VarsSameScore_it are fields. 
 		// When we get here they are the location where we need to start looking. 		
+		if (m_Score2Vars.empty()) break;
 		if (m_should_reset_iterators) reset_iterators(m_curr_activity);
 		Var v = 0;
 		int cnt = 0;
@@ -266,7 +585,7 @@ SolverState Solver::decide(){
 				if (state[v] == VarState::V_UNASSIGNED) { // found a var to assign
 					m_curr_activity = m_Score2Vars_it->first;
 					assert(m_curr_activity == m_activity[v]);
-					best_lit = getVal(v);					
+					best_lit = getVal<Cfg>(v);					
 					goto Apply_decision;
 				}
 			}
@@ -280,24 +599,13 @@ SolverState Solver::decide(){
 	}	
 		
 	assert(!best_lit);
-	S.print_state(Assignment_file);
 	return SolverState::SAT;
 
 
 Apply_decision:	
-	dl++; // increase decision level
-	if (dl > max_dl) max_dl = dl;
-	// Ensure separators/conflicts_at_dl are large enough (CB backtracking may have shrunk them).
-	// Check each vector independently: recompute_separators() sizes separators to dl+2 but
-	// only fills conflicts_at_dl up to dl+1, so they can be out of sync.
-	if (static_cast<int>(separators.size()) <= dl)
-		separators.resize(dl + 1, static_cast<int>(trail.size()));
-	if (static_cast<int>(conflicts_at_dl.size()) <= dl)
-		conflicts_at_dl.resize(dl + 1, num_learned);
-	separators[dl] = trail.size();
-	conflicts_at_dl[dl] = num_learned;
-	
+	new_decision_level();
 	assert_lit(best_lit);
+	antecedent(l2v(best_lit)) = -1;
 	// NOTE: decision lits track code for when we recompute the trail after backtracking with CB. 
 	if (static_cast<int>(decision_lits.size()) <= dl) decision_lits.resize(dl + 1, 0);
 	decision_lits[dl] = best_lit;
@@ -305,12 +613,29 @@ Apply_decision:
 	return SolverState::UNDEF;
 }
 
-inline ClauseState Clause::next_not_false(bool is_left_watch, Lit other_watch, bool binary, int& loc) {  
+void Clause::print_real_lits(Solver& solver) {
+	cout << "("; 
+	for (clause_it it = c.begin(); it != c.end(); ++it) cout << solver.lit_name(*it) << " ";
+	cout << ")"; 
+}
+
+void Clause::print_with_watches(Solver& solver) {		
+	for (clause_it it = c.begin(); it != c.end(); ++it) {
+		cout << solver.lit_name(*it);
+		int j = distance(c.begin(), it); //also could write "int j = i - c.begin();"  : the '-' operator is overloaded to allow such things. but distance is more standard, as it works on all standard containers.
+		if (j == lw) cout << "L";
+		if (j == rw) cout << "R";
+		cout << " ";
+	}
+}
+
+template <class Cfg>
+inline ClauseState Clause::next_not_false(Solver& solver, bool is_left_watch, Lit other_watch, bool binary, int& loc) {  
 	if (verbose_now()) cout << "next_not_false" << endl;
 	
 	if (!binary)
 		for (vector<int>::iterator it = c.begin(); it != c.end(); ++it) {
-			LitState LitState = S.lit_state(*it);
+			LitState LitState = solver.lit_state(*it);
 			if (LitState != LitState::L_UNSAT && *it != other_watch) { // found another watch_lit
 				loc = distance(c.begin(), it);
 				if (is_left_watch) lw = loc;    // if literal was the left one 
@@ -318,9 +643,9 @@ inline ClauseState Clause::next_not_false(bool is_left_watch, Lit other_watch, b
 				return ClauseState::C_UNDEF;
 			}
 		}
-	switch (S.lit_state(other_watch)) {
+	switch (solver.lit_state(other_watch)) {
 	case LitState::L_UNSAT: // conflict
-		if (verbose_now()) { print_real_lits(); cout << " is conflicting" << endl; }
+		if (verbose_now()) { print_real_lits(solver); cout << " is conflicting" << endl; }
 		return ClauseState::C_UNSAT;
 	case LitState::L_UNASSIGNED: return ClauseState::C_UNIT; // unit clause. Should assert the other watch_lit.	
 	case LitState::L_SAT: return ClauseState::C_SAT; // other literal is satisfied. 
@@ -331,6 +656,7 @@ inline ClauseState Clause::next_not_false(bool is_left_watch, Lit other_watch, b
 void Solver::test() { // tests that each clause is watched twice. 	
 	for (unsigned int idx = 0; idx < cnf.size(); ++idx) {
 		Clause c = cnf[idx];
+		if (c.is_deleted()) continue;
 		bool found = false;
 		for (int zo = 0; zo <= 1; ++zo) {
 			for (vector<int>::iterator it = watches[c.cl()[zo]].begin(); !found && it != watches[c.cl()[zo]].end(); ++it) {				
@@ -350,6 +676,7 @@ void Solver::test() { // tests that each clause is watched twice.
 	}
 }
 
+template <class Cfg>
 SolverState Solver::BCP() {
 	if (verbose_now()) cout << "BCP" << endl;
 	if (verbose_now()) cout << "qhead = " << qhead << " trail-size = " << trail.size() << endl;
@@ -364,19 +691,20 @@ SolverState Solver::BCP() {
 		// 	// if (verbose_now()) cout << "skipping unassigned literal " << l2rl(NegatedLit) << " at qhead " << qhead - 1 << endl;
 		// 	continue;
 		// }
-		if (verbose_now()) cout << "propagating " << l2rl(lit_negate(NegatedLit)) << endl;
+		if (verbose_now()) cout << "propagating " << lit_name(lit_negate(NegatedLit)) << endl;
 		vector<int> new_watch_list; // The original watch list minus those clauses that changed a watch. The order is maintained. 
 		int new_watch_list_idx = watches[NegatedLit].size() - 1; // Since we are traversing the watch_list backwards, this index goes down.
 		new_watch_list.resize(watches[NegatedLit].size());
 		for (vector<int>::reverse_iterator it = watches[NegatedLit].rbegin(); it != watches[NegatedLit].rend() && conflicting_clause_idx < 0; ++it) {
 			Clause& c = cnf[*it];
+			++num_visits;
 			Lit l_watch = c.get_lw_lit(), 
 				r_watch = c.get_rw_lit();			
 			bool binary = c.size() == 2;
 			bool is_left_watch = (l_watch == NegatedLit);
 			Lit other_watch = is_left_watch? r_watch: l_watch;
 			int NewWatchLocation;
-			ClauseState res = c.next_not_false(is_left_watch, other_watch, binary, NewWatchLocation);
+			ClauseState res = c.next_not_false<Cfg>(*this, is_left_watch, other_watch, binary, NewWatchLocation);
 			if (res != ClauseState::C_UNDEF) new_watch_list[new_watch_list_idx--] = *it; //in all cases but the move-watch_lit case we leave watch_lit where it is
 			switch (res) {
 			case ClauseState::C_UNSAT: { // conflict				
@@ -397,24 +725,24 @@ SolverState Solver::BCP() {
 			case ClauseState::C_UNIT: { // new implication				
 				if (verbose_now()) cout << "propagating: ";
 				int implied_level = dl;
-				if (enable_cb) {
+				if (Cfg::cb) {
 					int max_level = 0;
 					for (clause_it lit_it = c.cl().begin(); lit_it != c.cl().end(); ++lit_it) {
 						if (*lit_it == other_watch) continue;
-						max_level = max(max_level, dlevel[l2v(*lit_it)]);
+						max_level = max(max_level, dlevel(l2v(*lit_it)));
 					}
 					implied_level = max_level;
 				}
 				assert_lit(other_watch, implied_level);
-				antecedent[l2v(other_watch)] = *it;
-				if (verbose_now()) cout << "new implication <- " << l2rl(other_watch) << endl;
+				antecedent(l2v(other_watch)) = *it;
+				if (verbose_now()) cout << "new implication <- " << lit_name(other_watch) << endl;
 				break;
 			}
 			default: // replacing watch_lit
 				Assert(NewWatchLocation < static_cast<int>(c.size()));
 				int new_lit = c.lit(NewWatchLocation);
 				watches[new_lit].push_back(*it);
-				if (verbose_now()) { c.print_real_lits(); cout << " now watched by " << l2rl(new_lit) << endl;}
+				if (verbose_now()) { c.print_real_lits(*this); cout << " now watched by " << lit_name(new_lit) << endl;}
 			}
 		}
 		// resetting the list of clauses watched by this literal.
@@ -442,30 +770,31 @@ assumes: 1) no clause should have the same literal twice. To guarantee this we r
 This is Alg. 1 from "HaifaSat: a SAT solver based on an Abstraction/Refinement model" 
 ********************************************************************************************************************/
 
+template <class Cfg>
 int Solver::analyze(const Clause conflicting) {
 	if (verbose_now()) cout << "analyze" << endl;
 	Clause	current_clause = conflicting, 
 			new_clause;
 	int resolve_num = 0,
 		bktrk = 0, 
-		watch_lit = 0, // points to what literal in the learnt clause should be watched, other than the asserting one
-		antecedents_idx = 0;
+		watch_lit = 0; // points to what literal in the learnt clause should be watched, other than the asserting one
+	vector<int> hints; // LRAT: ids of the antecedents resolved on, in resolution order
 
 	Lit u;
-	Var v;
+	Var v = 0;
 	trail_t::reverse_iterator t_it = trail.rbegin();
 	do {
 		for (clause_it it = current_clause.cl().begin(); it != current_clause.cl().end(); ++it) {
 			Lit lit = *it;
 			v = l2v(lit);
-			if (!marked[v]) {
-				marked[v] = true;
-				if (dlevel[v] == dl) ++resolve_num;
+			if (!marked(v)) {
+				marked(v) = true;
+				if (dlevel(v) == dl) ++resolve_num;
 				else { // literals from previos decision levels (roots) are entered to the learned clause.
 					new_clause.insert(lit);
-					if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) bumpVarScore(v);
-					if (ValDecHeuristic == VAL_DEC_HEURISTIC::LITSCORE) bumpLitScore(lit);
-					int c_dl = dlevel[v];
+					if (Cfg::var_dh == VAR_DEC_HEURISTIC::MINISAT) bumpVarScore(v);
+					if (Cfg::val_dh == VAL_DEC_HEURISTIC::LITSCORE) bumpLitScore(lit);
+					int c_dl = dlevel(v);
 					if (c_dl > bktrk) {
 						bktrk = c_dl;
 						watch_lit = new_clause.size() - 1;
@@ -479,45 +808,61 @@ int Solver::analyze(const Clause conflicting) {
 			v = l2v(u);
 			++t_it;
 			// NOTE: are we sure that is always true? maybe the check is not good!
-			Assert(dlevel[v] <= dl);
+			Assert(dlevel(v) <= dl);
 			// With CB, the trail has interleaved decision levels.
 			// Only stop on marked variables at the current decision level. we want to enter the rest of the marked variables to the conflict clause!
-			if (marked[v] && dlevel[v] == dl) break;
+			if (marked(v) && dlevel(v) == dl) break;
 		}
-		marked[v] = false;
+		marked(v) = false;
 		--resolve_num;
 		if(!resolve_num) continue; 
-		int ant = antecedent[v];
+		int ant = antecedent(v);
 		Assert(ant >= 0 && ant < static_cast<int>(cnf.size()));
 		current_clause = cnf[ant]; 
+		if (cnf[ant].mark_used()) ++num_import_used;
+		if (trace_hints) hints.push_back(cnf[ant].get_id());
 		current_clause.cl().erase(find(current_clause.cl().begin(), current_clause.cl().end(), u));	
 	}	while (resolve_num > 0);
 
 	for (clause_it it = new_clause.cl().begin(); it != new_clause.cl().end(); ++it) 
-		marked[l2v(*it)] = false;
+		marked(l2v(*it)) = false;
 
 	Lit Negated_u = lit_negate(u);
 	new_clause.cl().push_back(Negated_u);		
-	if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) 
+	if (Cfg::var_dh == VAR_DEC_HEURISTIC::MINISAT) 
 		m_var_inc *= 1 / var_decay; // increasing importance of participating variables.
 	
 	++num_learned;
 	asserted_lit = Negated_u;
 	if (verbose_now())
 	{
-		cout << "Current uip: " << l2rl(u) << endl;
+		cout << "Current uip: " << lit2ext(u) << endl;
+	}
+	if (trace) { // under the negation of the learned clause the antecedents become unit in trail order, then the conflict
+		reverse(hints.begin(), hints.end());
+		hints.push_back(conflicting.get_id());
+		new_clause.set_id(proof_add(new_clause.cl(), hints));
+		if (new_clause.size() == 1) unit_id[l2v(Negated_u)] = new_clause.get_id();
 	}
 	if (new_clause.size() == 1) { // unary clause	
 		add_unary_clause(Negated_u);
 	}
 	else {
+		new_clause.set_learnt();
 		add_clause(new_clause, watch_lit, new_clause.size() - 1);
 	}
+	if (exchange) export_clause(new_clause);
+	if (learn_cb && static_cast<int>(new_clause.size()) <= learn_max) {
+		vector<int> ext;
+		for (clause_it it = new_clause.cl().begin(); it != new_clause.cl().end() && lit2ext(*it); ++it) ext.push_back(lit2ext(*it));
+		ext.push_back(0);
+		if (ext.size() == new_clause.size() + 1) learn_cb(learn_data, ext.data()); // skip clauses with internal variables
+	}
 	
 
 	if (verbose_now()) {	
 		cout << "Learned clause #" << cnf_size() + unaries.size() << ". "; 
-		new_clause.print_real_lits(); 
+		new_clause.print_real_lits(*this); 
 		cout << endl;
 		cout << " learnt clauses:  " << num_learned;				
 		cout << " Backtrack level " << bktrk << endl;
@@ -529,6 +874,29 @@ int Solver::analyze(const Clause conflicting) {
 	return bktrk; 
 }
 
+/* Final conflict analysis: assumption p is false in the middle of the assumption levels. 
+Walks the trail backwards from ~p through the antecedents and collects the assumptions 
+(decisions above level 0) it depends on. All the decision levels at this point are assumption levels. */
+void Solver::analyze_final(Lit p) {
+	failed_assumptions.clear();
+	failed_assumptions.push_back(p);
+	if (dlevel(l2v(p)) == 0) return;
+	marked(l2v(p)) = true;
+	for (int i = static_cast<int>(trail.size()) - 1; i >= 0; --i) {
+		Var v = l2v(trail[i]);
+		if (!marked(v)) continue;
+		marked(v) = false;
+		if (dlevel(v) == 0) continue;
+		int ant = antecedent(v);
+		if (ant == -1) { // an assumption
+			failed_assumptions.push_back(trail[i]);
+			continue;
+		}
+		for (clause_it it = cnf[ant].cl().begin(); it != cnf[ant].cl().end(); ++it)
+			if (l2v(*it) != v && dlevel(l2v(*it)) > 0) marked(l2v(*it)) = true;
+	}
+}
+
 void Solver::backtrack_ncb(int k) {
 	if (verbose_now()) cout << "backtrack (NCB)" << endl;
 	// Ensure arrays are large enough
@@ -542,8 +910,8 @@ void Solver::backtrack_ncb(int k) {
 
 	for (trail_t::iterator it = trail.begin() + separators[k + 1]; it != trail.end(); ++it) {
 		Var v = l2v(*it);
-		if (dlevel[v]) {
-			state[v] = VarState::V_UNASSIGNED;
+		if (dlevel(v)) {
+			unassign(v);
 			if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) m_curr_activity = max(m_curr_activity, m_activity[v]);
 		}
 	}
@@ -554,9 +922,9 @@ void Solver::backtrack_ncb(int k) {
 	dl = k;
 	if (static_cast<int>(decision_lits.size()) > dl) decision_lits.resize(dl + 1);
 	assert_lit(asserted_lit);
-	Assert(antecedent.size() > l2v(asserted_lit));
+	Assert(nvars >= l2v(asserted_lit));
 	Assert(cnf.size() > 0);
-	antecedent[l2v(asserted_lit)] = cnf.size() - 1;
+	antecedent(l2v(asserted_lit)) = cnf.size() - 1;
 	conflicting_clause_idx = -1;
 	// Ensure separators is large enough before setting separators[dl + 1]
 	if (static_cast<int>(separators.size()) <= dl + 1) separators.resize(dl + 2, static_cast<int>(trail.size()));
@@ -580,12 +948,12 @@ void Solver::backtrack_cb(int k, int conflict_cls_blevel) {
 	vector<Lit> out_of_order;
 	for (int i = cut; i < static_cast<int>(trail.size()); ++i) {
 		Var v = l2v(trail[i]);
-		if (dlevel[v] <= k) {
+		if (dlevel(v) <= k) {
 			if (state[v] != VarState::V_UNASSIGNED)
 				out_of_order.push_back(trail[i]);
-		} else if (dlevel[v] != 0) {
+		} else if (dlevel(v) != 0) {
 			// only unassign variables that are not unit (dlevel 0)
-			state[v] = VarState::V_UNASSIGNED;
+			unassign(v);
 			if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) m_curr_activity = max(m_curr_activity, m_activity[v]);
 		}
 	}
@@ -600,7 +968,7 @@ void Solver::backtrack_cb(int k, int conflict_cls_blevel) {
 
 	if (verbose_now()) {
 		cout << "After backtrack to level " << k << ", trail is: ";
-		for (Lit l : trail) cout << l2rl(l) << "@" << dlevel[l2v(l)] << "|" << antecedent[l2v(l)] << " ";
+		for (Lit l : trail) cout << lit_name(l) << "@" << dlevel(l2v(l)) << "|" << antecedent(l2v(l)) << " ";
 		cout << endl;
 	}
 
@@ -610,9 +978,9 @@ void Solver::backtrack_cb(int k, int conflict_cls_blevel) {
 
 	// NOTE!: the decision level here of the lit should not be k (i think!)
 	assert_lit(asserted_lit, conflict_cls_blevel);
-	Assert(antecedent.size() > l2v(asserted_lit));
+	Assert(nvars >= l2v(asserted_lit));
 	Assert(cnf.size() > 0);
-	antecedent[l2v(asserted_lit)] = cnf.size() - 1;
+	antecedent(l2v(asserted_lit)) = cnf.size() - 1;
 	conflicting_clause_idx = -1;
 	separators[k + 1] = static_cast<int>(trail.size()); // sentinel: end of current trail
 }
@@ -627,13 +995,13 @@ void Solver::backtrack_cb_preserve(int k) {
 	vector<Lit> out_of_order;
 	for (int i = cut; i < static_cast<int>(trail.size()); ++i) {
 		Var v = l2v(trail[i]);
-		if (dlevel[v] <= k) {
+		if (dlevel(v) <= k) {
 			if (state[v] != VarState::V_UNASSIGNED)
 				out_of_order.push_back(trail[i]);
-		} else if (dlevel[v] != 0) {
+		} else if (dlevel(v) != 0) {
 			// only unassign variables that are not unit (dlevel 0)
-			state[v] = VarState::V_UNASSIGNED;
-			// antecedent[v] = -1; // we also need to reset the antecedent because we will re-analyze the same conflict clause and we want to make sure that we do not get confused by old antecedents.
+			unassign(v);
+			// antecedent(v) = -1; // we also need to reset the antecedent because we will re-analyze the same conflict clause and we want to make sure that we do not get confused by old antecedents.
 			if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) m_curr_activity = max(m_curr_activity, m_activity[v]);
 		}
 	}
@@ -648,7 +1016,7 @@ void Solver::backtrack_cb_preserve(int k) {
 
 	if (verbose_now()) {
 		cout << "After backtrack to level " << k << ", trail is: ";
-		for (Lit l : trail) cout << l2rl(l) << "@" << dlevel[l2v(l)] << "|" << antecedent[l2v(l)] << " ";
+		for (Lit l : trail) cout << lit_name(l) << "@" << dlevel(l2v(l)) << "|" << antecedent(l2v(l)) << " ";
 		cout << endl;
 	}
 
@@ -658,6 +1026,31 @@ void Solver::backtrack_cb_preserve(int k) {
 	separators[k + 1] = static_cast<int>(trail.size()); // sentinel: end of current trail
 }
 
+// Plain backtrack to level k: unlike backtrack_ncb()/backtrack_cb() it neither restarts nor asserts 
+// a learned literal. Literals at levels <= k that CB placed above separators[k+1] stay on the trail 
+// and are re-propagated. Lits below the cut were propagated before level k+1 existed, so qhead = cut suffices. 
+void Solver::backtrack_to(int k) {
+	if (dl <= k) return;
+	int cut = separators[k + 1], keep = cut;
+	for (int i = cut; i < static_cast<int>(trail.size()); ++i) {
+		Var v = l2v(trail[i]);
+		if (dlevel(v) <= k) trail[keep++] = trail[i];
+		else {
+			unassign(v);
+			// m_curr_activity == 0 means decide() starts from the top score anyway (see restart()). 
+			if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT && m_curr_activity > 0) m_curr_activity = max(m_curr_activity, m_activity[v]);
+		}
+	}
+	trail.resize(keep);
+	qhead = cut;
+	dl = k;
+	if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) m_should_reset_iterators = true;
+	if (static_cast<int>(decision_lits.size()) > dl + 1) decision_lits.resize(dl + 1);
+	separators.resize(k + 2);
+	if (static_cast<int>(conflicts_at_dl.size()) > k + 1) conflicts_at_dl.resize(k + 2);
+	separators[k + 1] = static_cast<int>(trail.size());
+}
+
 // Returns the actual backtrack level b under the active CB heuristic.
 // j = asserting level from analyze(); uses current dl as conflict level c.
 int Solver::determine_backtrack_level(int j) {
@@ -676,30 +1069,31 @@ int Solver::reusetrail_backtrack_level(int j) {
 	double best_score = -1.0;
 	for (size_t i = 0; i < trail.size(); ++i) {
 		Var v = l2v(trail[i]);
-		int lv = dlevel[v];
+		int lv = dlevel(v);
 		if (lv > j && lv <= c && m_activity[v] > best_score) {
 			best_score = m_activity[v];
 			best_var = v;
 		}
 	}
-	if (best_var == 0 || dlevel[best_var] <= j) return max(0, c - 1); // fallback to always-CB
-	return max(0, dlevel[best_var] - 1);
+	if (best_var == 0 || dlevel(best_var) <= j) return max(0, c - 1); // fallback to always-CB
+	return max(0, dlevel(best_var) - 1);
 }
 
 void Solver::validate_assignment() {
 	for (unsigned int i = 1; i <= nvars; ++i) if (state[i] == VarState::V_UNASSIGNED) {
-		cout << "Unassigned var: " + to_string(i) << endl; // This is supposed to happen only if the variable does not appear in any clause
+		cout << "Unassigned var: " + to_string(int2ext[i]) << endl; // This is supposed to happen only if the variable does not appear in any clause
 	}
 	for (vector<Clause>::iterator it = cnf.begin(); it != cnf.end(); ++it) {
+		if (it->is_deleted()) continue;
 		int found = 0;
 		for(clause_it it_c = it->cl().begin(); it_c != it->cl().end() && !found; ++it_c) 
 			if (lit_state(*it_c) == LitState::L_SAT) found = 1;
 		if (!found) {
 			cout << "fail on clause: "; 
-			it->print_real_lits();
+			it->print_real_lits(*this);
 			cout << endl;
 			for (clause_it it_c = it->cl().begin(); it_c != it->cl().end() && !found; ++it_c)
-				cout << l2rl(*it_c) << " (" << (int) lit_state(*it_c) << ") ";
+				cout << lit2ext(*it_c) << " (" << (int) lit_state(*it_c) << ") ";
 			cout << endl;
 			Abort("Assignment validation failed", 3);
 		}
@@ -722,9 +1116,9 @@ void Solver::restart() {
 	if (verbose >=1) cout << "restart: new threshold = " << restart_threshold << endl;
 	++num_restarts;
 	for (unsigned int i = 1; i <= nvars; ++i) 
-		if (dlevel[i] > 0) {
-			state[i] = VarState::V_UNASSIGNED;
-			dlevel[i] = 0;
+		if (dlevel(i) > 0) {
+			unassign(i);
+			dlevel(i) = 0;
 		}	
 	trail.clear();
 	qhead = 0;
@@ -737,13 +1131,256 @@ void Solver::restart() {
 	reset();
 }
 
+/*******************************************************************************************************************
+name: vivify
+Learned-clause vivification. Invoked at level 0 with BCP complete. For each candidate clause C = (l1 .. ln), 
+C is detached and ~l1, ~l2, ... are asserted at temporary decision levels, each followed by BCP():
+	li false  -> li is implied by the earlier negations and is dropped;
+	li true   -> (l1 .. li) is implied by the rest of the formula; 
+	conflict  -> (l1 .. li) is implied by the rest of the formula. 
+If the implied clause is all of C, C is redundant and deleted. Otherwise C is replaced by the shorter clause. 
+Candidates are learned clauses not yet vivified, taken in the order they were learned, until 
+BCP() has visited viv_budget watched clauses. 
+********************************************************************************************************************/
+SolverState Solver::vivify() {
+	if (verbose_now()) cout << "vivify" << endl;
+	Assert(dl == 0 && qhead == trail.size());
+	long long budget = num_visits + viv_budget;
+	for (; viv_next < cnf.size() && num_visits < budget; ++viv_next) {
+		int idx = viv_next;
+		Clause& c = cnf[idx];
+		if (!c.is_learnt() || c.is_deleted() || c.size() <= 2) continue;
+		bool sat = false;
+		for (clause_it it = c.cl().begin(); it != c.cl().end() && !sat; ++it)
+			if (lit_state(*it) == LitState::L_SAT) sat = true; // satisfied at level 0
+		if (sat) continue;
+
+		detach_clause(idx);
+		clause_t lits = c.cl(), new_lits;
+		bool implied = false;
+		int refuter = -1; // LRAT: the clause falsified under the negation of new_lits
+		for (clause_it it = lits.begin(); it != lits.end() && !implied; ++it) {
+			switch (lit_state(*it)) {
+			case LitState::L_UNSAT: break; // implied false: drop it
+			case LitState::L_SAT: 
+				new_lits.push_back(*it); 
+				implied = true; 
+				if (dlevel(l2v(*it))) refuter = antecedent(l2v(*it));
+				break;
+			default:
+				new_lits.push_back(*it);
+				new_decision_level();
+				assert_lit(lit_negate(*it));
+				antecedent(l2v(*it)) = -1;
+				if (BCP() == SolverState::CONFLICT) {
+					refuter = conflicting_clause_idx;
+					conflicting_clause_idx = -1;
+					implied = true;
+				}
+			}
+		}
+		vector<int> hints;
+		if (trace_hints && new_lits.size() < lits.size()) {
+			if (!implied) refuter = idx; // only false literals were dropped
+			if (refuter >= 0) conflict_hints(refuter, new_lits, hints);
+			else hints.push_back(root_unit_id(l2v(new_lits.back()))); // the last literal is true at level 0
+		}
+		backtrack_to(0);
+
+		if (implied && new_lits.size() == lits.size()) { // C follows from the other clauses
+			if (trace) proof_delete(c.get_id(), lits);
+			c.mark_deleted();
+			++num_viv_deleted;
+			continue;
+		}
+		int new_id = 0;
+		if (new_lits.size() < lits.size()) {
+			++num_vivified;
+			num_viv_lits += lits.size() - new_lits.size();
+			if (verbose_now()) { c.print_real_lits(*this); cout << " vivified to " << new_lits.size() << " literals" << endl; }
+			if (trace) { new_id = proof_add(new_lits, hints); proof_delete(c.get_id(), lits); }
+		}
+		if (new_lits.size() == 1) { // became a unit
+			Lit l = new_lits[0];
+			c.mark_deleted();
+			unit_id[l2v(l)] = new_id;
+			assert_lit(l);
+			add_unary_clause(l);
+			if (BCP() == SolverState::UNSAT) return SolverState::UNSAT;
+			continue;
+		}
+		// all remaining literals are unassigned at level 0, so any two of them can be watched. 
+		if (new_lits.size() < lits.size()) {
+			c.cl().swap(new_lits);
+			c.set_id(new_id);
+			c.lw_set(0);
+			c.rw_set(1);
+		}
+		watches[c.get_lw_lit()].push_back(idx);
+		watches[c.get_rw_lit()].push_back(idx);
+	}
+	return SolverState::UNDEF;
+}
+
+/*******************************************************************************************************************
+name: simplify
+Level-0 simplification, invoked at level 0 with BCP complete whenever new level-0 literals were assigned since 
+the previous call. Clauses satisfied at level 0 are deleted, and literals false at level 0 are removed from the 
+rest. Since BCP is complete, a clause that is not satisfied keeps at least two (unassigned) literals. 
+Only the affected clauses are detached: each watch list that holds one of them is filtered once, and the 
+shortened clauses are then watched on their first two literals. 
+********************************************************************************************************************/
+void Solver::simplify() {
+	if (verbose_now()) cout << "simplify" << endl;
+	Assert(dl == 0 && qhead == trail.size());
+	simp_root_lits = num_root_lits;
+	if (trace) // the antecedents of level-0 literals are satisfied clauses, deleted below
+		for (unsigned int v = 1; v <= nvars; ++v) 
+			if (state[v] != VarState::V_UNASSIGNED) root_unit_id(v);
+	vector<bool> affected(cnf.size(), false);
+	vector<Lit> touched; // the watched literals of the affected clauses
+	for (unsigned int idx = 0; idx < cnf.size(); ++idx) {
+		Clause& c = cnf[idx];
+		if (c.is_deleted()) continue;
+		bool sat = false, shrink = false;
+		for (clause_it it = c.cl().begin(); it != c.cl().end() && !sat; ++it) {
+			switch (lit_state(*it)) {
+			case LitState::L_SAT: sat = true; break;
+			case LitState::L_UNSAT: shrink = true; break;
+			default: break;
+			}
+		}
+		if (!sat && !shrink) continue;
+		affected[idx] = true;
+		touched.push_back(c.get_lw_lit());
+		touched.push_back(c.get_rw_lit());
+		if (sat) {
+			if (trace) proof_delete(c.get_id(), c.cl());
+			c.mark_deleted();
+			++num_simp_deleted;
+			continue;
+		}
+		clause_t& lits = c.cl();
+		size_t old_size = lits.size();
+		clause_t old_lits;
+		vector<int> hints; // LRAT: the units of the removed literals, then the clause
+		if (trace) {
+			old_lits = lits;
+			for (clause_it it = lits.begin(); it != lits.end(); ++it) 
+				if (lit_state(*it) == LitState::L_UNSAT) hints.push_back(unit_id[l2v(*it)]);
+			hints.push_back(c.get_id());
+		}
+		lits.erase(remove_if(lits.begin(), lits.end(), [this](Lit l) { return lit_state(l) == LitState::L_UNSAT; }), lits.end());
+		Assert(lits.size() > 1);
+		if (trace) {
+			int id = proof_add(lits, hints);
+			proof_delete(c.get_id(), old_lits);
+			c.set_id(id);
+		}
+		num_simp_lits += old_size - lits.size();
+		c.lw_set(0);
+		c.rw_set(1);
+	}
+	sort(touched.begin(), touched.end());
+	touched.erase(unique(touched.begin(), touched.end()), touched.end());
+	for (clause_it it = touched.begin(); it != touched.end(); ++it) {
+		vector<int>& wl = watches[*it];
+		wl.erase(remove_if(wl.begin(), wl.end(), [&affected](int idx) { return affected[idx]; }), wl.end());
+	}
+	for (unsigned int idx = 0; idx < cnf.size(); ++idx) {
+		if (!affected[idx] || cnf[idx].is_deleted()) continue;
+		watches[cnf[idx].get_lw_lit()].push_back(idx);
+		watches[cnf[idx].get_rw_lit()].push_back(idx);
+	}
+}
+
 void Solver::solve() { 
-	SolverState res = _solve(); 	
+	report(_solve());
+}
+
+/* Model enumeration: each model is printed as a `v ... 0' line as soon as it is found (over the projection 
+variables, if given), then blocked by the negation of its decisions on the projection variables. Since these 
+are decided first, they determine the projected model. The search then resumes with the learned clauses kept. */
+void Solver::enumerate(int max_models) {
+	SolverState res = SolverState::UNDEF;
+	int models = 0;
+	vector<int> block;
+	while (models < max_models) {
+		res = _solve();
+		if (res != SolverState::SAT) break;
+		++models;
+		block.clear();
+		cout << "v";
+		for (unsigned int i = 1; i <= (project.empty() ? nvars : project.size()); ++i) {
+			Var v = project.empty() ? i : project[i - 1];
+			if (state[v] == VarState::V_UNASSIGNED) continue; // does not occur in the formula
+			int lit = state[v] == VarState::V_TRUE ? int2ext[v] : -int2ext[v];
+			cout << " " << lit;
+			if (dlevel(v) > 0 && antecedent(v) == -1) block.push_back(-lit); // a decision
+		}
+		cout << " 0" << endl;
+		add_input_clause(block); // empty if the model follows from level 0: then the formula becomes UNSAT
+	}
+	print_stats();
+	cout << "Models: " << models << endl;
+	if (res == SolverState::TIMEOUT) cout << "S TIMEOUT" << endl;
+	else cout << (models ? "S SAT" : "S UNSAT") << endl;
+}
+
+/* Backbone: the literals that are true in every model. The literals of a first model are the candidates. 
+Then up to chunk of them, c1..ck, are tested at a time, by solving with the clause (~c1 | .. | ~ck) in a clause 
+group (push/pop). UNSAT: c1..ck are backbone literals, and are added as units. SAT: the model drops every candidate 
+that it falsifies, at least one of c1..ck among them. Level-0 literals are backbone literals without a test. 
+All calls run on the same solver and keep the learned clauses. */
+void Solver::backbone(int chunk) {
+	SolverState res = _solve();
+	if (res != SolverState::SAT) {
+		report(res);
+		return;
+	}
+	vector<Lit> cand, bb;
+	for (unsigned int v = 1; v <= nvars; ++v)
+		if (int2ext[v] && state[v] != VarState::V_UNASSIGNED) cand.push_back(v2l(state[v] == VarState::V_TRUE ? v : -static_cast<int>(v)));
+	int calls = 1;
+	while (true) {
+		backtrack_to(0);
+		vector<Lit>::iterator root = stable_partition(cand.begin(), cand.end(), [this](Lit l) { return lit_state(l) != LitState::L_SAT; });
+		bb.insert(bb.end(), root, cand.end());
+		cand.erase(root, cand.end());
+		if (cand.empty()) break;
+		int k = min(chunk, static_cast<int>(cand.size()));
+		clause_t refute; // the negation of the last k candidates
+		for (vector<Lit>::iterator it = cand.end() - k; it != cand.end(); ++it) refute.push_back(lit_negate(*it));
+		push();
+		add_clause_lits(refute);
+		assumptions = group_acts;
+		res = _solve();
+		++calls;
+		if (res == SolverState::SAT) 
+			cand.erase(remove_if(cand.begin(), cand.end(), [this](Lit l) { return lit_state(l) != LitState::L_SAT; }), cand.end());
+		pop();
+		if (res == SolverState::TIMEOUT) break;
+		if (res == SolverState::UNSAT) 
+			for (int i = 0; i < k; ++i) {
+				add_clause_lits(clause_t(1, cand.back()));
+				bb.push_back(cand.back());
+				cand.pop_back();
+			}
+	}
+	assumptions.clear();
+	print_stats();
+	cout << "Solve calls: " << calls << endl << "Backbone: " << bb.size() << " literals" << (cand.empty() ? "" : " (incomplete)") << endl << "b";
+	for (vector<Lit>::iterator it = bb.begin(); it != bb.end(); ++it) cout << " " << lit2ext(*it);
+	cout << " 0" << endl << (res == SolverState::TIMEOUT ? "S TIMEOUT" : "S SAT") << endl;
+}
+
+void Solver::report(SolverState res) {
 	Assert(res == SolverState::SAT || res == SolverState::UNSAT || res == SolverState::TIMEOUT);
-	S.print_stats();
+	print_stats();
 	switch (res) {
 	case SolverState::SAT: {
-		S.validate_assignment();
+		print_state(Assignment_file);
+		validate_assignment();
 		string str = "solution in ",
 			str1 = Assignment_file;
 		cout << str + str1 << endl;
@@ -751,6 +1388,11 @@ void Solver::solve() {
 		break;
 	}
 	case SolverState::UNSAT: 
+		if (!assumptions.empty()) {
+			cout << "Failed assumptions:";
+			for (clause_it it = failed_assumptions.begin(); it != failed_assumptions.end(); ++it) cout << " " << lit2ext(*it);
+			cout << endl;
+		}
 		cout << "S UNSAT" << endl;
 		break;
 	case SolverState::TIMEOUT: 
@@ -760,23 +1402,46 @@ void Solver::solve() {
 	return;
 }
 
+// A conflict at level 0: the formula is UNSAT regardless of the assumptions. 
+SolverState Solver::root_conflict() {
+	unsat = true;
+	if (trace) { // the empty clause. Hints: the units of a clause falsified at level 0, then the clause
+		vector<int> hints;
+		for (unsigned int idx = 0; idx < cnf.size() && hints.empty() && trace_hints; ++idx) {
+			Clause& c = cnf[idx];
+			if (c.is_deleted() || !all_of(c.cl().begin(), c.cl().end(), [this](Lit l) { return lit_state(l) == LitState::L_UNSAT; })) continue;
+			for (clause_it it = c.cl().begin(); it != c.cl().end(); ++it) hints.push_back(root_unit_id(l2v(*it)));
+			hints.push_back(c.get_id());
+		}
+		int id = proof_add(clause_t(), hints);
+		if (!core_file.empty()) write_core(id);
+	}
+	return SolverState::UNSAT;
+}
+
+template <class Cfg>
 SolverState Solver::_solve() {
 	SolverState res;
+	failed_assumptions.clear();
+	if (unsat) return SolverState::UNSAT;
+	backtrack_to(0); // a previous call may have stopped at a model
 	while (true) {
-		if (timeout > 0 && cpuTime() - begin_time > timeout) return SolverState::TIMEOUT;
+		if (timed_out()) return SolverState::TIMEOUT;
+		if (terminate && terminate->load(memory_order_relaxed)) return SolverState::TIMEOUT;
+		if (terminate_cb && terminate_cb(terminate_data)) return SolverState::TIMEOUT;
 		while (true) {
-			res = BCP();
-			if (res == SolverState::UNSAT) return res;
+			res = BCP<Cfg>();
+			if (res == SolverState::UNSAT) return root_conflict();
 			if (res == SolverState::CONFLICT) {
 				++num_conflicts;
 				int original_dl = dl;
-				if (enable_cb) {
+				if (Cfg::cb) {
 					Clause& cc = cnf[conflicting_clause_idx];
 					int max_level = 0, second_level = 0, max_count = 0;
 					Lit max_level_lit = 0;
 					for (clause_it it = cc.cl().begin(); it != cc.cl().end(); ++it) {
-						int lv = dlevel[l2v(*it)];
-						if (verbose_now()) cout << "literal " << l2rl(*it) << " at level " << lv << endl;
+						int lv = dlevel(l2v(*it));
+						if (verbose_now()) cout << "literal " << lit_name(*it) << " at level " << lv << endl;
 						if (lv > max_level) {
 							second_level = max_level;
 							max_level = lv;
@@ -819,7 +1484,7 @@ SolverState Solver::_solve() {
 						}
 						// Assert the implied literal so BCP can propagate it
 						assert_lit(max_level_lit, bt_level);
-						antecedent[l2v(max_level_lit)] = clause_idx;
+						antecedent(l2v(max_level_lit)) = clause_idx;
 						conflicting_clause_idx = -1;
 						continue; // continue with BCP
 					} else if (max_count > 1) {
@@ -828,12 +1493,13 @@ SolverState Solver::_solve() {
 					}
 					// If max_level == second_level or other cases, continue with normal analysis
 				}
-				int blevel = analyze(cnf[conflicting_clause_idx]);
+				if (cnf[conflicting_clause_idx].mark_used()) ++num_import_used;
+				int blevel = analyze<Cfg>(cnf[conflicting_clause_idx]);
 				// Determine actual backtrack target and which path to take
 				bool use_ncb;
 				int target;
 				// NOTE: the blevel == 0 check for NCB is for fixing bug when we dont NCB on new learnt lits in global level 0, seems to fix the issue, should look more into it.
-				if (!enable_cb || blevel == 0) {
+				if (!Cfg::cb || blevel == 0) {
 					// NCB mode, or blevel==0 (global unit): always NCB
 					use_ncb = true;
 					target = blevel;
@@ -853,33 +1519,1212 @@ SolverState Solver::_solve() {
 					// backtrack_ncb cuts blindly at separators[blevel+1] and can wrongly unassign
 					// variables with dlevel <= blevel that sit physically past that separator.
 					// backtrack_cb handles the interleaved trail correctly in all cases.
-					if (enable_cb) backtrack_cb(blevel, blevel);
+					if (Cfg::cb) backtrack_cb(blevel, blevel);
 					else backtrack_ncb(blevel);
 				}
 				else { ++num_cb_backtracks;  backtrack_cb(target, blevel); }
 			}
 			else break;
 		}
-		res = decide();
-		if (res == SolverState::SAT) return res;
+		if (dl == 0 && exchange && num_restarts > import_restart_mark) {
+			import_restart_mark = num_restarts;
+			if (import_clauses() == SolverState::UNSAT) return root_conflict();
+		}
+		if (dl == 0 && enable_simp && num_root_lits > simp_root_lits) simplify();
+		if (dl == 0 && enable_viv && num_restarts > viv_restart_mark) {
+			viv_restart_mark = num_restarts;
+			if (vivify() == SolverState::UNSAT) return root_conflict();
+		}
+		res = decide<Cfg>();
+		if (res == SolverState::SAT || res == SolverState::UNSAT) return res;
+	}
+}
+
+/* Runs stmt with Cfg set to the SolverConfig that matches the options of this solver. The options are read once 
+per call, so they may differ between solvers (portfolio workers) and change between calls, but not during one. */
+#define WITH_SOLVER_CONFIG(stmt) \
+	Assert(VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT); \
+	switch ((enable_cb ? 1 : 0) | (ValDecHeuristic == VAL_DEC_HEURISTIC::LITSCORE ? 2 : 0)) { \
+	case 0: { typedef SolverConfig<false, VAR_DEC_HEURISTIC::MINISAT, VAL_DEC_HEURISTIC::PHASESAVING> Cfg; stmt; } \
+	case 1: { typedef SolverConfig<true, VAR_DEC_HEURISTIC::MINISAT, VAL_DEC_HEURISTIC::PHASESAVING> Cfg; stmt; } \
+	case 2: { typedef SolverConfig<false, VAR_DEC_HEURISTIC::MINISAT, VAL_DEC_HEURISTIC::LITSCORE> Cfg; stmt; } \
+	default: { typedef SolverConfig<true, VAR_DEC_HEURISTIC::MINISAT, VAL_DEC_HEURISTIC::LITSCORE> Cfg; stmt; } \
 	}
+
+SolverState Solver::_solve() {
+	WITH_SOLVER_CONFIG(return _solve<Cfg>());
+}
+
+SolverState Solver::BCP() {
+	WITH_SOLVER_CONFIG(return BCP<Cfg>());
+}
+
+int Solver::analyze(const Clause conflicting) {
+	WITH_SOLVER_CONFIG(return analyze<Cfg>(conflicting));
 }
 
 #pragma endregion solving
 
+/******************  Portfolio ******************************/
+#pragma region portfolio
+
+// Configuration of portfolio worker #worker. Worker 0 keeps the command-line configuration; 
+// workers beyond the table repeat it with a random initial phase. 
+void Solver::diversify(int worker) {
+	static const int n_configs = 8;
+	switch (worker % n_configs) {
+	case 0: break;
+	case 1: enable_cb = 1; cb_heuristic = 0; break;
+	case 2: enable_cb = 1; cb_heuristic = 1; cb_threshold = 100; break;
+	case 3: enable_cb = 1; cb_heuristic = 2; break;
+	case 4: ValDecHeuristic = VAL_DEC_HEURISTIC::LITSCORE; break;
+	case 5: restart_threshold = restart_lower = 50; restart_upper = 500; restart_multiplier = 1.5f; break;
+	case 6: enable_viv = 0; restart_threshold = restart_lower = 200; restart_upper = 2000; break;
+	case 7: enable_cb = 1; ValDecHeuristic = VAL_DEC_HEURISTIC::LITSCORE; break;
+	}
+	if (worker >= n_configs) {
+		mt19937 rng(worker);
+		for (unsigned int v = 1; v <= nvars; ++v) 
+			prev_state[v] = (rng() & 1) ? VarState::V_TRUE : VarState::V_FALSE;
+	}
+	m_should_reset_iterators = true; // the copied iterators point into the original solver's map
+}
 
-/******************  main ******************************/
+bool ClauseExchange::put(int producer, const clause_t& c) {
+	unsigned long long ticket = head.fetch_add(1, memory_order_relaxed);
+	Slot& slot = slots[ticket % Capacity];
+	unsigned long long seq = slot.seq.load(memory_order_relaxed);
+	if ((seq & 1) || seq > 2 * ticket || !slot.seq.compare_exchange_strong(seq, 2 * ticket + 1, memory_order_acquire))
+		return false; // another producer owns the slot
+	atomic_thread_fence(memory_order_release);
+	slot.producer.store(producer, memory_order_relaxed);
+	slot.size.store(static_cast<int>(c.size()), memory_order_relaxed);
+	for (unsigned int i = 0; i < c.size(); ++i) slot.lits[i].store(c[i], memory_order_relaxed);
+	slot.seq.store(2 * ticket + 2, memory_order_release);
+	return true;
+}
+
+// Appends to out the clauses published since cursor by producers other than consumer, and advances cursor. 
+void ClauseExchange::get(int consumer, unsigned long long& cursor, vector<clause_t>& out) {
+	unsigned long long h = head.load(memory_order_acquire);
+	if (h - cursor > Capacity) cursor = h - Capacity; // the older ones were overwritten
+	for (; cursor < h; ++cursor) {
+		Slot& slot = slots[cursor % Capacity];
+		unsigned long long seq = slot.seq.load(memory_order_acquire);
+		if (seq == 2 * cursor + 1) break; // being written; retry next time
+		if (seq != 2 * cursor + 2) continue; // dropped (the slot was busy) or already overwritten
+		int producer = slot.producer.load(memory_order_relaxed),
+			size = slot.size.load(memory_order_relaxed);
+		clause_t c(size);
+		for (int i = 0; i < size; ++i) c[i] = slot.lits[i].load(memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+		if (slot.seq.load(memory_order_relaxed) != seq || producer == consumer) continue;
+		out.push_back(c);
+	}
+}
+
+// Offers a clause just learned by analyze() to the other workers if it is short and has a low LBD 
+// (number of distinct decision levels), so that imports do not flood their watch lists. 
+void Solver::export_clause(Clause& c) {
+	clause_t& lits = c.cl();
+	if (static_cast<int>(lits.size()) > share_size) return;
+	int lbd = 0;
+	for (unsigned int i = 0; i < lits.size(); ++i) {
+		unsigned int j = 0;
+		while (j < i && dlevel(l2v(lits[j])) != dlevel(l2v(lits[i]))) ++j;
+		if (j == i) ++lbd;
+	}
+	if (lbd > share_lbd) return;
+	if (exchange->put(worker_id, lits)) ++num_exported;
+}
+
+// Adds the clauses exported by other workers since the last call. Invoked at level 0 with BCP complete. 
+// Literals false at level 0 are dropped, and clauses satisfied at level 0 are ignored. 
+SolverState Solver::import_clauses() {
+	vector<clause_t> received;
+	exchange->get(worker_id, exchange_cursor, received);
+	bool new_units = false;
+	for (vector<clause_t>::iterator it = received.begin(); it != received.end(); ++it) {
+		Clause c;
+		bool sat = false;
+		for (clause_it lit_it = it->begin(); lit_it != it->end() && !sat; ++lit_it) {
+			LitState st = lit_state(*lit_it);
+			if (st == LitState::L_SAT) sat = true;
+			else if (st == LitState::L_UNASSIGNED) c.insert(*lit_it);
+		}
+		if (sat) continue;
+		++num_imported;
+		if (c.size() == 0) return SolverState::UNSAT;
+		if (c.size() == 1) {
+			assert_lit(c.lit(0));
+			add_unary_clause(c.lit(0));
+			new_units = true;
+			continue;
+		}
+		c.set_learnt();
+		c.set_imported();
+		add_clause(c, 0, 1);
+	}
+	if (new_units && BCP() == SolverState::UNSAT) return SolverState::UNSAT;
+	return SolverState::UNDEF;
+}
+
+// Runs n diversified copies of the (already parsed) solver S in parallel, exchanging short learned 
+// clauses at restarts. The first SAT/UNSAT answer stops the others and is reported. 
+void solve_portfolio(const Solver& S, int n) {
+	vector<Solver> workers(n, S);
+	ClauseExchange exchange;
+	atomic<bool> stop(false);
+	mutex m;
+	int winner = -1;
+	SolverState result = SolverState::TIMEOUT;
+	vector<thread> pool;
+	for (int i = 0; i < n; ++i) {
+		workers[i].diversify(i);
+		workers[i].set_terminate(&stop);
+		if (enable_share) workers[i].set_exchange(&exchange, i);
+		pool.push_back(thread([&, i]() {
+			SolverState res = workers[i]._solve();
+			if (res != SolverState::SAT && res != SolverState::UNSAT) return;
+			lock_guard<mutex> lock(m);
+			if (winner < 0) {
+				winner = i;
+				result = res;
+			}
+			stop = true;
+		}));
+	}
+	for (thread& t : pool) t.join();
+	if (enable_share) 
+		for (int i = 0; i < n; ++i) workers[i].print_sharing_stats();
+	if (winner >= 0) cout << "Portfolio: answer by worker " << winner << endl;
+	workers[max(winner, 0)].report(result);
+}
+
+/*******************************************************************************************************************
+name: lookahead
+Picks a branching variable for cube generation at the current node (BCP complete, no conflict). 
+Each of the lookahead_candidates unassigned variables with the highest score is tried in both polarities 
+at a temporary level, and scored by the product of the number of literals BCP() assigns in each. 
+A polarity that leads to a conflict is a failed literal: its negation is asserted at the node's level 
+(and recorded as a unary clause at level 0). If both polarities fail the node is refuted. The scores taken 
+before a failed literal are stale (BCP may even have assigned the best candidate), so the candidates are then 
+scored again. 
+Returns 0 if the node is refuted or every variable is assigned. 
+********************************************************************************************************************/
+Var Solver::lookahead(bool& refuted) {
+	static const unsigned int lookahead_candidates = 32;
+	refuted = false;
+	vector<Var> cand;
+	for (unsigned int v = 1; v <= nvars; ++v) 
+		if (state[v] == VarState::V_UNASSIGNED) cand.push_back(v);
+	if (cand.size() > lookahead_candidates) {
+		partial_sort(cand.begin(), cand.begin() + lookahead_candidates, cand.end(),
+			[this](Var a, Var b) { return m_activity[a] > m_activity[b]; });
+		cand.resize(lookahead_candidates);
+	}
+	Var best = 0;
+	long long best_score = -1;
+	for (int i = 0; i < static_cast<int>(cand.size()); ++i) {
+		Var v = cand[i];
+		if (state[v] != VarState::V_UNASSIGNED) continue; // assigned by a failed literal
+		long long cnt[2];
+		Lit failed = 0;
+		for (int pol = 0; pol <= 1; ++pol) {
+			Lit l = v2l(pol ? v : -v);
+			int before = trail.size();
+			new_decision_level();
+			assert_lit(l);
+			antecedent(v) = -1;
+			bool conflict = BCP() == SolverState::CONFLICT;
+			cnt[pol] = trail.size() - before;
+			conflicting_clause_idx = -1;
+			backtrack_to(dl - 1);
+			if (conflict) {
+				if (failed) { refuted = true; return 0; }
+				failed = l;
+			}
+		}
+		if (failed) {
+			Lit l = lit_negate(failed);
+			assert_lit(l);
+			antecedent(v) = -1;
+			if (dl == 0) add_unary_clause(l);
+			SolverState res = BCP();
+			if (res != SolverState::UNDEF) {
+				conflicting_clause_idx = -1;
+				refuted = true;
+				return 0;
+			}
+			best = 0; // rescore: each failed literal assigns v, so this ends
+			best_score = -1;
+			i = -1;
+			continue;
+		}
+		long long score = cnt[0] * cnt[1] + cnt[0] + cnt[1];
+		if (score > best_score) {
+			best_score = score;
+			best = v;
+		}
+	}
+	Assert(best == 0 || state[best] == VarState::V_UNASSIGNED);
+	return best;
+}
+
+// Splits the formula at the current node into cubes of up to depth decisions, by recursive lookahead. 
+// Refuted nodes produce no cube. 
+void Solver::split_cubes(clause_t& cube, int depth, vector<clause_t>& cubes) {
+	bool refuted;
+	Var v = depth > 0 ? lookahead(refuted) : 0;
+	if (depth > 0 && refuted) return;
+	if (v == 0) { // leaf
+		cubes.push_back(cube);
+		return;
+	}
+	for (int pol = 1; pol >= 0; --pol) {
+		Lit l = v2l(pol ? v : -v);
+		new_decision_level();
+		assert_lit(l);
+		antecedent(v) = -1;
+		if (BCP() == SolverState::UNDEF) {
+			cube.push_back(l);
+			split_cubes(cube, depth - 1, cubes);
+			cube.pop_back();
+		}
+		conflicting_clause_idx = -1;
+		backtrack_to(dl - 1);
+	}
+}
+
+// Returns the cubes for cube-and-conquer (none if the formula is refuted). Invoked at level 0. 
+vector<clause_t> Solver::make_cubes(int depth) {
+	vector<clause_t> cubes;
+	clause_t cube;
+	if (BCP() != SolverState::UNDEF) unsat = true;
+	else split_cubes(cube, depth, cubes);
+	if (cubes.empty()) unsat = true;
+	return cubes;
+}
+
+// Cube-and-conquer: S (already parsed) is split into cubes by lookahead, and n diversified workers solve 
+// them as assumptions. Each worker owns a deque of cubes and, once it is empty, steals from the others. 
+// SAT as soon as a cube is satisfiable; UNSAT once every cube is refuted. 
+void solve_cubes(Solver& S, int depth, int n) {
+	vector<clause_t> cubes = S.make_cubes(depth);
+	cout << "Cube-and-conquer: " << cubes.size() << " cubes (depth " << depth << ") in " << cpuTime() - begin_time << " secs." << endl;
+	if (S.is_unsat()) { // refuted by the lookahead
+		S.report(SolverState::UNSAT);
+		return;
+	}
+
+	vector<Solver> workers(n, S);
+	vector<deque<clause_t> > queues(n);
+	vector<mutex> queue_locks(n);
+	for (unsigned int i = 0; i < cubes.size(); ++i) queues[i % n].push_back(cubes[i]);
+	ClauseExchange exchange;
+	atomic<bool> stop(false);
+	atomic<int> refuted(0);
+	mutex m;
+	int winner = -1;
+	SolverState result = SolverState::TIMEOUT;
+	vector<thread> pool;
+	for (int i = 0; i < n; ++i) {
+		workers[i].diversify(i);
+		workers[i].set_terminate(&stop);
+		if (enable_share) workers[i].set_exchange(&exchange, i);
+		pool.push_back(thread([&, i]() {
+			while (!stop) {
+				clause_t c;
+				bool found = false;
+				for (int k = 0; k < n && !found; ++k) { // own queue first (LIFO), then steal (FIFO)
+					int q = (i + k) % n;
+					lock_guard<mutex> lock(queue_locks[q]);
+					if (queues[q].empty()) continue;
+					if (k == 0) { c = queues[q].back(); queues[q].pop_back(); }
+					else { c = queues[q].front(); queues[q].pop_front(); }
+					found = true;
+				}
+				if (!found) return;
+				workers[i].set_assumptions(c);
+				SolverState res = workers[i]._solve();
+				if (res == SolverState::UNSAT && !workers[i].is_unsat()) { ++refuted; continue; }
+				lock_guard<mutex> lock(m);
+				if (res != SolverState::TIMEOUT && winner < 0) {
+					winner = i;
+					result = res;
+				}
+				stop = true;
+			}
+		}));
+	}
+	for (thread& t : pool) t.join();
+	if (winner < 0 && refuted == static_cast<int>(cubes.size())) result = SolverState::UNSAT;
+	cout << "Cube-and-conquer: " << refuted << " of " << cubes.size() << " cubes refuted" << endl;
+	Solver& w = workers[max(winner, 0)];
+	if (result == SolverState::UNSAT) w.set_assumptions(clause_t()); // UNSAT of the formula, not under w's last cube
+	w.report(result);
+}
+
+/* Process portfolio: forks n children after parsing, so that the clause DB is shared copy-on-write rather 
+than parsed n times. Each child runs a diversified configuration. The first child with a definitive answer 
+claims a flag in shared memory, reports (including the assignment file), and notifies the parent through 
+a pipe; the parent then kills the rest. EOF on the pipe means that no child found an answer. */
+void solve_procs(Solver& S, int n) {
+#ifdef _MSC_VER
+	Abort("-procs is not supported on this platform", 2);
+#else
+	int fds[2];
+	if (pipe(fds) != 0) Abort("cannot create a pipe", 3);
+	void* shared = mmap(nullptr, sizeof(atomic<int>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED) Abort("cannot map shared memory", 3);
+	atomic<int>* claim = new (shared) atomic<int>(-1);
+	cout.flush(); // otherwise every child inherits the buffered output
+	vector<pid_t> children;
+	for (int i = 0; i < n; ++i) {
+		pid_t pid = fork();
+		if (pid < 0) Abort("fork failed", 3);
+		if (pid == 0) {
+			close(fds[0]);
+			begin_time = cpuTime(); // the child's resource usage starts from 0
+			S.diversify(i);
+			SolverState res = S._solve();
+			int expected = -1;
+			if ((res == SolverState::SAT || res == SolverState::UNSAT) && claim->compare_exchange_strong(expected, i)) {
+				cout << "Process portfolio: answer by process " << i << endl;
+				S.report(res);
+				cout.flush();
+				char done = 1;
+				if (write(fds[1], &done, 1) != 1) _exit(1);
+			}
+			_exit(0);
+		}
+		children.push_back(pid);
+	}
+	close(fds[1]);
+	char done;
+	bool answered = read(fds[0], &done, 1) == 1;
+	for (vector<pid_t>::iterator it = children.begin(); it != children.end(); ++it) {
+		kill(*it, SIGKILL);
+		waitpid(*it, nullptr, 0);
+	}
+	close(fds[0]);
+	munmap(shared, sizeof(atomic<int>));
+	if (!answered) S.report(SolverState::TIMEOUT);
+#endif
+}
+
+/* Variable-disjoint components: after BCP at level 0, the variables of the clauses that are not satisfied yet 
+are joined by union-find. Each component, with these clauses restricted to their unassigned literals, is solved 
+by a separate solver; a pool of n threads takes the components largest first. An UNSAT component stops the others. 
+Otherwise the models are merged into this solver's assignment (at level 1), and report() validates it against all 
+the clauses. Variables in no remaining clause are set to their saved phase. */
+void Solver::solve_components(int n) {
+	if (BCP() == SolverState::UNSAT) {
+		report(root_conflict());
+		return;
+	}
+	vector<Var> parent(nvars + 1);
+	for (unsigned int v = 0; v <= nvars; ++v) parent[v] = v;
+	auto find = [&parent](Var v) {
+		while (parent[v] != v) v = parent[v] = parent[parent[v]];
+		return v;
+	};
+	vector<vector<int> > residual;
+	for (vector<Clause>::iterator it = cnf.begin(); it != cnf.end(); ++it) {
+		if (it->is_deleted() || any_of(it->cl().begin(), it->cl().end(), [this](Lit l) { return lit_state(l) == LitState::L_SAT; })) continue;
+		residual.push_back(vector<int>());
+		for (clause_it l = it->cl().begin(); l != it->cl().end(); ++l) {
+			if (lit_state(*l) != LitState::L_UNASSIGNED) continue;
+			residual.back().push_back(l2rl(*l));
+			parent[find(l2v(*l))] = find(Abs(residual.back()[0]));
+		}
+	}
+	unordered_map<Var, int> index; // root => component
+	vector<vector<vector<int> > > comps;
+	vector<int> comp_vars;
+	for (unsigned int v = 1; v <= nvars; ++v) {
+		if (state[v] != VarState::V_UNASSIGNED) continue;
+		Var r = find(v);
+		if (!index.count(r)) {
+			index[r] = comps.size();
+			comps.push_back(vector<vector<int> >());
+			comp_vars.push_back(0);
+		}
+		++comp_vars[index[r]];
+	}
+	for (vector<vector<int> >::iterator it = residual.begin(); it != residual.end(); ++it) 
+		comps[index[find(Abs((*it)[0]))]].push_back(*it);
+	vector<int> order;
+	for (unsigned int i = 0; i < comps.size(); ++i) if (!comps[i].empty()) order.push_back(i);
+	sort(order.begin(), order.end(), [&comp_vars](int a, int b) { return comp_vars[a] > comp_vars[b]; });
+	cout << "Components: " << order.size() << (order.empty() ? "" : " largest: " + to_string(comp_vars[order[0]]) + " variables") << endl;
+
+	vector<vector<int> > models(order.size());
+	atomic<int> next(0);
+	atomic<bool> stop(false);
+	atomic<bool> refuted(false), any_timed_out(false);
+	vector<thread> pool;
+	for (int t = 0; t < min(n, static_cast<int>(order.size())); ++t) 
+		pool.push_back(thread([&]() {
+			for (int i; !stop && (i = next++) < static_cast<int>(order.size()); ) {
+				Solver part;
+				part.initialize();
+				part.set_terminate(&stop);
+				vector<vector<int> >& clauses = comps[order[i]];
+				for (vector<vector<int> >::iterator it = clauses.begin(); it != clauses.end(); ++it) part.add_input_clause(*it);
+				SolverState res = part._solve();
+				if (res == SolverState::UNSAT) {
+					refuted = true;
+					stop = true;
+				}
+				else if (res == SolverState::TIMEOUT) any_timed_out = true;
+				else for (unsigned int v = 1; v < part.ext2int.size(); ++v)
+					if (part.model_value(v)) models[i].push_back(part.model_value(v));
+			}
+		}));
+	for (thread& t : pool) t.join();
+	if (refuted) {
+		unsat = true;
+		report(SolverState::UNSAT);
+		return;
+	}
+	if (any_timed_out) {
+		report(SolverState::TIMEOUT);
+		return;
+	}
+	new_decision_level();
+	for (vector<vector<int> >::iterator m = models.begin(); m != models.end(); ++m)
+		for (vector<int>::iterator it = m->begin(); it != m->end(); ++it) {
+			assert_lit(v2l(*it));
+			antecedent(Abs(*it)) = -1;
+		}
+	for (unsigned int v = 1; v <= nvars; ++v) 
+		if (state[v] == VarState::V_UNASSIGNED) {
+			assert_lit(v2l(prev_state[v] == VarState::V_TRUE ? v : -static_cast<int>(v)));
+			antecedent(v) = -1;
+		}
+	report(SolverState::SAT);
+}
+
+#pragma endregion portfolio
+
+
+/******************  Proof output (DRAT, LRAT) ******************************/
+#pragma region proof
+
+void ProofWriter::binary_line(char tag, const vector<int>& lits) {
+	buf.push_back(tag);
+	for (vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it) {
+		unsigned int u = 2 * Abs(*it) + (*it < 0);
+		while (u > 127) {
+			buf.push_back(static_cast<char>(128 | (u & 127)));
+			u >>= 7;
+		}
+		buf.push_back(static_cast<char>(u));
+	}
+	buf.push_back(0);
+}
+
+// Writes i and a space.
+void ProofWriter::text_int(int i) {
+	char digits[10];
+	int n = 0;
+	unsigned int u = Abs(i);
+	do { digits[n++] = static_cast<char>('0' + u % 10); u /= 10; } while (u);
+	if (i < 0) buf.push_back('-');
+	while (n) buf.push_back(digits[--n]);
+	buf.push_back(' ');
+}
+
+void ProofWriter::add(int id, const vector<int>& lits, const vector<int>& hints) {
+	last_id = id;
+	if (lrat) {
+		text_int(id);
+		for (vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it) text_int(*it);
+		text_int(0);
+		for (vector<int>::const_iterator it = hints.begin(); it != hints.end(); ++it) text_int(*it);
+		text_int(0);
+		buf.back() = '\n';
+	}
+	else binary_line('a', lits);
+	if (buf.size() >= Buffer_size) flush();
+}
+
+void ProofWriter::del(int id, const vector<int>& lits) {
+	if (lrat) {
+		text_int(last_id);
+		buf.push_back('d');
+		buf.push_back(' ');
+		text_int(id);
+		text_int(0);
+		buf.back() = '\n';
+	}
+	else binary_line('d', lits);
+	if (buf.size() >= Buffer_size) flush();
+}
+
+// Gives c a new id, which is returned, and writes it to the proof. The hints are kept if a core is to be written. 
+int Solver::proof_add(const clause_t& c, const vector<int>& hints) {
+	++last_id;
+	if (!core_file.empty()) {
+		derivation.resize(last_id + 1);
+		derivation[last_id] = hints;
+	}
+	if (!proof) return last_id;
+	vector<int> lits;
+	for (clause_t::const_iterator it = c.begin(); it != c.end(); ++it) lits.push_back(lit2ext(*it));
+	proof->add(last_id, lits, hints);
+	return last_id;
+}
+
+void Solver::proof_delete(int id, const clause_t& c) {
+	if (!proof) return;
+	vector<int> lits;
+	for (clause_t::const_iterator it = c.begin(); it != c.end(); ++it) lits.push_back(lit2ext(*it));
+	proof->del(id, lits);
+}
+
+/* The proof id of the unit clause of the level-0 literal of v. Literals that BCP implied at level 0 get their 
+unit clause on demand, with the units of the other literals of the antecedent and then the antecedent as hints. 
+simplify() calls it for all level-0 literals before it deletes their antecedents. */
+int Solver::root_unit_id(Var v) {
+	vector<Var> stack(1, v);
+	while (!stack.empty()) {
+		Var u = stack.back();
+		if (unit_id[u]) { stack.pop_back(); continue; }
+		Assert(dlevel(u) == 0 && antecedent(u) >= 0);
+		Clause& a = cnf[antecedent(u)];
+		size_t pending = stack.size();
+		for (clause_it it = a.cl().begin(); it != a.cl().end(); ++it)
+			if (l2v(*it) != u && !unit_id[l2v(*it)]) stack.push_back(l2v(*it));
+		if (stack.size() > pending) continue; // derive those first
+		stack.pop_back();
+		vector<int> hints;
+		for (clause_it it = a.cl().begin(); it != a.cl().end(); ++it) 
+			if (l2v(*it) != u) hints.push_back(unit_id[l2v(*it)]);
+		hints.push_back(a.get_id());
+		unit_id[u] = proof_add(clause_t(1, v2l(state[u] == VarState::V_TRUE ? u : -u)), hints);
+	}
+	return unit_id[v];
+}
+
+/* LRAT hints for clause c, whose negation (the decisions above level 0) propagated to a conflict on cnf[k]: 
+the units of the level-0 literals involved, then the antecedents of the implied literals in trail order, then cnf[k]. 
+The literals of c are not followed further. */
+void Solver::conflict_hints(int k, const clause_t& c, vector<int>& hints) {
+	vector<Var> seen;
+	vector<int> ants;
+	auto mark = [&](Clause& a) {
+		for (clause_it it = a.cl().begin(); it != a.cl().end(); ++it)
+			if (!marked(l2v(*it))) { marked(l2v(*it)) = true; seen.push_back(l2v(*it)); }
+	};
+	mark(cnf[k]);
+	for (trail_t::reverse_iterator t = trail.rbegin(); t != trail.rend(); ++t) {
+		Var v = l2v(*t);
+		if (!marked(v) || !dlevel(v)) continue;
+		bool in_c = false;
+		for (clause_t::const_iterator it = c.begin(); it != c.end() && !in_c; ++it) in_c = (l2v(*it) == v);
+		if (!in_c && antecedent(v) >= 0) {
+			ants.push_back(cnf[antecedent(v)].get_id());
+			mark(cnf[antecedent(v)]);
+		}
+		marked(v) = false; // after mark(): v occurs in its own antecedent
+	}
+	hints.clear();
+	for (vector<Var>::iterator it = seen.begin(); it != seen.end(); ++it) 
+		if (marked(*it)) { // a level-0 literal
+			marked(*it) = false;
+			hints.push_back(root_unit_id(*it));
+		}
+	hints.insert(hints.end(), ants.rbegin(), ants.rend());
+	hints.push_back(cnf[k].get_id());
+}
+
+// Writes the input clauses that clause id (the empty clause) was derived from to core_file, in DIMACS format. 
+void Solver::write_core(int id) {
+	int num_input = static_cast<int>(input_clauses.size()), size = 0, vars = 0;
+	vector<bool> in_core(last_id + 1, false);
+	vector<int> stack(1, id);
+	while (!stack.empty()) {
+		int i = stack.back();
+		stack.pop_back();
+		if (in_core[i]) continue;
+		in_core[i] = true;
+		if (i > num_input) stack.insert(stack.end(), derivation[i].begin(), derivation[i].end());
+	}
+	for (int i = 1; i <= num_input; ++i) {
+		if (!in_core[i]) continue;
+		++size;
+		for (vector<int>::iterator it = input_clauses[i - 1].begin(); it != input_clauses[i - 1].end(); ++it) vars = max(vars, static_cast<int>(Abs(*it)));
+	}
+	ofstream out(core_file);
+	if (!out.good()) Abort("cannot write core file", 1);
+	out << "p cnf " << vars << " " << size << endl;
+	for (int i = 1; i <= num_input; ++i) {
+		if (!in_core[i]) continue;
+		for (vector<int>::iterator it = input_clauses[i - 1].begin(); it != input_clauses[i - 1].end(); ++it) out << *it << " ";
+		out << "0" << endl;
+	}
+	cout << "core: " << size << " of " << num_input << " input clauses, written to " << core_file << endl;
+}
+
+#pragma endregion proof
+
+
+/******************  Incremental interface (IPASIR) ******************************/
+#pragma region ipasir
+
+/* Adds a clause between solve calls. DIMACS variables seen for the first time get a fresh variable. 
+Inside a clause group (push()), the clause is extended with the negation of the group's activation literal. 
+The clause is then simplified against the level-0 assignment: it is dropped if satisfied or tautological, 
+false literals are removed, a unit is asserted at level 0 (BCP() propagates it on the next _solve()), 
+and an empty clause makes the formula UNSAT. */
+void Solver::add_input_clause(const vector<int>& lits) {
+	if (unsat) return;
+	clause_t c;
+	for (vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it) c.push_back(ext2lit(*it));
+	add_clause_lits(c);
+}
+
+// As add_input_clause(), with literals of the solver. 
+void Solver::add_clause_lits(const clause_t& lits) {
+	if (unsat) return;
+	backtrack_to(0); // the previous model is no longer needed
+	set<Lit> s;
+	for (clause_t::const_iterator it = lits.begin(); it != lits.end(); ++it) {
+		Lit l = *it;
+		if (VarDecHeuristic == VAR_DEC_HEURISTIC::MINISAT) bumpVarScore(l2v(l));
+		if (ValDecHeuristic == VAL_DEC_HEURISTIC::LITSCORE) bumpLitScore(l);
+		s.insert(l);
+	}
+	if (!group_acts.empty()) s.insert(lit_negate(group_acts.back()));
+	// the score map changed: decide() starts again from the top
+	m_curr_activity = 0;
+	m_should_reset_iterators = true;
+	Clause c;
+	for (set<Lit>::iterator it = s.begin(); it != s.end(); ++it) {
+		if (s.count(lit_negate(*it))) return; // tautology
+		switch (lit_state(*it)) {
+		case LitState::L_SAT: return;
+		case LitState::L_UNSAT: break;
+		default: c.insert(*it);
+		}
+	}
+	switch (c.size()) {
+	case 0: unsat = true; break;
+	case 1: 
+		assert_lit(c.lit(0));
+		antecedent(l2v(c.lit(0))) = -1;
+		add_unary_clause(c.lit(0));
+		break;
+	default: add_clause(c, 0, 1);
+	}
+}
+
+// The activation literals of the open clause groups are assumed as well. 
+void Solver::set_input_assumptions(const vector<int>& lits) {
+	assumptions = group_acts;
+	for (vector<int>::const_iterator it = lits.begin(); it != lits.end(); ++it)
+		assumptions.push_back(ext2lit(*it));
+}
+
+int Solver::model_value(int lit) {
+	if (Abs(lit) >= ext2int.size() || !ext2int[Abs(lit)]) return 0;
+	switch (lit_state(ext2lit(lit))) {
+	case LitState::L_SAT: return lit;
+	case LitState::L_UNSAT: return -lit;
+	default: return 0;
+	}
+}
+
+bool Solver::failed(int lit) {
+	if (Abs(lit) >= ext2int.size() || !ext2int[Abs(lit)]) return false;
+	return find(failed_assumptions.begin(), failed_assumptions.end(), ext2lit(lit)) != failed_assumptions.end();
+}
+
+// Opens a clause group: a fresh activation variable a is assumed by every solve call, and the clauses 
+// added until the matching pop() get the literal ~a. 
+void Solver::push() {
+	group_acts.push_back(v2l(new_var(0)));
+}
+
+/* Closes the innermost clause group by asserting ~a at level 0. This satisfies the group's clauses and 
+every learned clause derived from them (those contain ~a, since a is a decision), and simplify() deletes 
+them at the next restart. */
+void Solver::pop() {
+	if (group_acts.empty()) return;
+	Lit a = group_acts.back();
+	group_acts.pop_back();
+	if (unsat) return;
+	backtrack_to(0);
+	if (lit_state(a) != LitState::L_UNASSIGNED) return; // already refuted by the solver
+	assert_lit(lit_negate(a));
+	antecedent(l2v(a)) = -1;
+	add_unary_clause(lit_negate(a));
+}
+
+struct IpasirSolver {
+	Solver S;
+	vector<int> clause, assumptions; // under construction, in DIMACS format
+	IpasirSolver() { S.initialize(); }
+};
+
+extern "C" {
+
+const char* ipasir_signature() { return "edusat"; }
+
+void* ipasir_init() { return new IpasirSolver(); }
+
+void ipasir_release(void* solver) { delete static_cast<IpasirSolver*>(solver); }
+
+void ipasir_add(void* solver, int lit_or_zero) {
+	IpasirSolver* w = static_cast<IpasirSolver*>(solver);
+	if (lit_or_zero) { w->clause.push_back(lit_or_zero); return; }
+	w->S.add_input_clause(w->clause);
+	w->clause.clear();
+}
+
+void ipasir_assume(void* solver, int lit) { static_cast<IpasirSolver*>(solver)->assumptions.push_back(lit); }
+
+int ipasir_solve(void* solver) {
+	IpasirSolver* w = static_cast<IpasirSolver*>(solver);
+	w->S.set_input_assumptions(w->assumptions);
+	w->assumptions.clear();
+	switch (w->S._solve()) {
+	case SolverState::SAT: return 10;
+	case SolverState::UNSAT: return 20;
+	default: return 0;
+	}
+}
+
+int ipasir_val(void* solver, int lit) { return static_cast<IpasirSolver*>(solver)->S.model_value(lit); }
+
+int ipasir_failed(void* solver, int lit) { return static_cast<IpasirSolver*>(solver)->S.failed(lit) ? 1 : 0; }
+
+void ipasir_set_terminate(void* solver, void* data, int (*terminate)(void* data)) {
+	static_cast<IpasirSolver*>(solver)->S.set_terminate(data, terminate);
+}
+
+void ipasir_set_learn(void* solver, void* data, int max_length, void (*learn)(void* data, int* clause)) {
+	static_cast<IpasirSolver*>(solver)->S.set_learn(data, max_length, learn);
+}
+
+void edusat_push(void* solver) { static_cast<IpasirSolver*>(solver)->S.push(); }
+
+void edusat_pop(void* solver) { static_cast<IpasirSolver*>(solver)->S.pop(); }
+
+}
+
+#pragma endregion ipasir
+
+
+/******************  MaxSAT ******************************/
+#pragma region maxsat
+
+// The total weight of the soft clauses that the current assignment does not satisfy. 
+long long Solver::soft_cost() {
+	long long cost = 0;
+	for (unsigned int i = 0; i < soft.size(); ++i) 
+		if (none_of(soft[i].begin(), soft[i].end(), [this](Lit l) { return lit_state(l) == LitState::L_SAT; })) cost += soft_weight[i];
+	return cost;
+}
+
+/* Core-guided weighted MaxSAT: PM-RES (Narodytska & Bacchus, AAAI 2014) with stratification. 
+Soft clause C gets a selector s, the literal itself for a unit and a fresh variable with the hard clause (C | ~s) 
+otherwise, and the selectors are solved as assumptions. A core s1..sk (the failed assumptions), whose least weight 
+is w, raises the lower bound by w and takes w off each si. By MaxRes, the soft clauses si | (s1 & .. & s(i-1)), 
+i = 2..k, are added with weight w, as selectors di with the hard clauses (~di | si | zi), zi => s1 & .. & s(i-1), 
+together with the hard clause (~s1 | .. | ~sk). 
+Stratification: only selectors of weight >= level are assumed. When they are satisfiable, level goes down to the 
+next weight, and the model is an upper bound. Improved upper bounds are printed as `o' lines as they are found; 
+the search ends when the lower bound meets the best one, or on timeout with the best model so far. */
+void Solver::solve_maxsat() {
+	vector<Lit> sel;            // selectors
+	vector<long long> weight;   // their remaining weight
+	unordered_map<Lit, int> index; // selector => position in sel
+	long long lb = 0, ub = LLONG_MAX;
+	vector<int> best;           // the best model, in DIMACS format
+	for (unsigned int i = 0; i < soft.size(); ++i) {
+		if (soft[i].empty()) { lb += soft_weight[i]; continue; } // always falsified
+		Lit s = soft[i][0];
+		if (soft[i].size() > 1) {
+			s = v2l(new_var(0));
+			clause_t h = soft[i];
+			h.push_back(lit_negate(s));
+			add_clause_lits(h);
+		}
+		if (!index.count(s)) {
+			index[s] = sel.size();
+			sel.push_back(s);
+			weight.push_back(0);
+		}
+		weight[index[s]] += soft_weight[i];
+	}
+	long long level = 0;
+	for (unsigned int j = 0; j < weight.size(); ++j) level = max(level, weight[j]);
+	int cores = 0;
+	SolverState res = SolverState::UNDEF;
+	while (lb < ub) {
+		assumptions.clear();
+		for (unsigned int j = 0; j < sel.size(); ++j) if (weight[j] > 0 && weight[j] >= level) assumptions.push_back(sel[j]);
+		res = _solve();
+		if (res == SolverState::TIMEOUT) break;
+		if (res == SolverState::SAT) {
+			long long cost = soft_cost();
+			if (cost < ub) {
+				ub = cost;
+				best.clear();
+				for (unsigned int v = 1; v < ext2int.size(); ++v) best.push_back(model_value(v) ? model_value(v) : -static_cast<int>(v));
+				cout << "o " << ub << endl;
+			}
+			long long next = 0; // the next stratification level
+			for (unsigned int j = 0; j < weight.size(); ++j) if (weight[j] < level) next = max(next, weight[j]);
+			if (!next) break; // all selectors were assumed: the model is optimal
+			level = next;
+			continue;
+		}
+		if (unsat) break; // the hard clauses are UNSAT
+		++cores;
+		vector<int> core;
+		long long w = LLONG_MAX;
+		for (clause_it it = failed_assumptions.begin(); it != failed_assumptions.end(); ++it) {
+			core.push_back(index[*it]);
+			w = min(w, weight[index[*it]]);
+		}
+		lb += w;
+		clause_t at_least_one; // one of the core's soft clauses is falsified
+		for (unsigned int i = 0; i < core.size(); ++i) {
+			weight[core[i]] -= w;
+			at_least_one.push_back(lit_negate(sel[core[i]]));
+		}
+		add_clause_lits(at_least_one);
+		Lit z = sel[core[0]]; // s1 & .. & s(i-1)
+		for (unsigned int i = 1; i < core.size(); ++i) {
+			Lit s = sel[core[i]], d = v2l(new_var(0));
+			add_clause_lits(clause_t{lit_negate(d), s, z});
+			index[d] = sel.size();
+			sel.push_back(d);
+			weight.push_back(w);
+			if (i + 1 == core.size()) break;
+			Lit z2 = v2l(new_var(0));
+			add_clause_lits(clause_t{lit_negate(z2), z});
+			add_clause_lits(clause_t{lit_negate(z2), s});
+			z = z2;
+		}
+	}
+	assumptions.clear();
+	print_stats();
+	cout << "Cores: " << cores << " lower bound: " << lb << endl;
+	if (ub == LLONG_MAX) {
+		cout << (res == SolverState::TIMEOUT ? "s UNKNOWN" : "s UNSATISFIABLE") << endl;
+		return;
+	}
+	cout << (res == SolverState::TIMEOUT && lb < ub ? "s SATISFIABLE" : "s OPTIMUM FOUND") << endl << "v ";
+	for (vector<int>::iterator it = best.begin(); it != best.end(); ++it) cout << (*it > 0 ? '1' : '0');
+	cout << endl;
+}
 
+#pragma endregion maxsat
+
+/******************  Model counting ******************************/
+#pragma region counting
+
+BigUint& BigUint::operator+=(const BigUint& b) {
+	if (limbs.size() < b.limbs.size()) limbs.resize(b.limbs.size(), 0);
+	uint64_t carry = 0;
+	for (size_t i = 0; i < limbs.size(); ++i) {
+		carry += static_cast<uint64_t>(limbs[i]) + (i < b.limbs.size() ? b.limbs[i] : 0);
+		limbs[i] = static_cast<uint32_t>(carry);
+		carry >>= 32;
+	}
+	if (carry) limbs.push_back(static_cast<uint32_t>(carry));
+	return *this;
+}
+
+BigUint BigUint::operator*(const BigUint& b) const {
+	BigUint r;
+	if (is_zero() || b.is_zero()) return r;
+	r.limbs.assign(limbs.size() + b.limbs.size(), 0);
+	for (size_t i = 0; i < limbs.size(); ++i) {
+		uint64_t carry = 0;
+		for (size_t j = 0; j < b.limbs.size(); ++j) { // cannot overflow: (2^32 - 1)^2 + 2 (2^32 - 1) = 2^64 - 1
+			carry += static_cast<uint64_t>(limbs[i]) * b.limbs[j] + r.limbs[i + j];
+			r.limbs[i + j] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		r.limbs[i + b.limbs.size()] = static_cast<uint32_t>(carry);
+	}
+	while (!r.limbs.back()) r.limbs.pop_back();
+	return r;
+}
+
+BigUint& BigUint::operator<<=(unsigned int bits) {
+	if (is_zero()) return *this;
+	if (bits % 32) {
+		uint32_t carry = 0;
+		for (vector<uint32_t>::iterator it = limbs.begin(); it != limbs.end(); ++it) {
+			uint32_t next = *it >> (32 - bits % 32);
+			*it = *it << (bits % 32) | carry;
+			carry = next;
+		}
+		if (carry) limbs.push_back(carry);
+	}
+	limbs.insert(limbs.begin(), bits / 32, 0);
+	return *this;
+}
+
+string BigUint::to_string() const {
+	if (is_zero()) return "0";
+	vector<uint32_t> q(limbs), digits; // digits: base 10^9, least significant first
+	while (!q.empty()) {
+		uint64_t rem = 0;
+		for (size_t i = q.size(); i-- > 0; ) {
+			uint64_t cur = rem << 32 | q[i];
+			q[i] = static_cast<uint32_t>(cur / 1000000000);
+			rem = cur % 1000000000;
+		}
+		digits.push_back(static_cast<uint32_t>(rem));
+		while (!q.empty() && !q.back()) q.pop_back();
+	}
+	ostringstream out;
+	out << digits.back();
+	for (size_t i = digits.size() - 1; i-- > 0; ) out << setw(9) << setfill('0') << digits[i];
+	return out.str();
+}
+
+/* Exact model counting (#SAT). The unassigned variables of the input clauses that are not satisfied yet split 
+into connected components; the count is the product of their counts, times 2 per variable in no such clause. 
+A component is counted by branching on its most active variable, with BCP() after each decision. Conflicts are 
+analyzed and learned as in _solve(), but backtracking is chronological, since both branches are needed: back 
+at the branching level, the learned clause is unit, and its literal is asserted and propagated there. 
+Component counts are cached, keyed by the component's variables and clause indices (delta-encoded). 
+A learned clause is implied by the whole formula but not necessarily by the component, so a count that depended 
+on one may be too low - only when another open component has no models, so the total is right. Such counts 
+are not cached ('exact' is false). */
+void Solver::count() {
+	enable_cb = 0;
+	occurs.assign(nvars + 1, vector<int>());
+	for (unsigned int idx = 0; idx < cnf.size(); ++idx)
+		for (clause_it it = cnf[idx].cl().begin(); it != cnf[idx].cl().end(); ++it) occurs[l2v(*it)].push_back(idx);
+	BigUint n;
+	bool exact, done = true;
+	if (BCP() != SolverState::UNSAT) {
+		vector<Var> vars;
+		for (unsigned int v = 1; v <= nvars; ++v) vars.push_back(v);
+		done = count_residual(vars, n, exact);
+		n <<= std::count(ext2int.begin() + 1, ext2int.end(), 0); // declared variables that were not allocated (-compact) are free
+	}
+	print_stats();
+	cout << "Components: " << num_components << " cache hits: " << num_cache_hits << endl;
+	if (!done) {
+		cout << "S TIMEOUT" << endl;
+		return;
+	}
+	cout << "Models: " << n.to_string() << endl << (n.is_zero() ? "S UNSAT" : "S SAT") << endl;
+}
+
+// The # of models of the residual formula over vars (unassigned variables of some components). false on timeout. 
+bool Solver::count_residual(const vector<Var>& vars, BigUint& n, bool& exact) {
+	vector<vector<Var> > comp_vars;
+	vector<vector<int> > comp_clauses;
+	vector<Var> stack;
+	unsigned int free_vars = 0;
+	for (vector<Var>::const_iterator v = vars.begin(); v != vars.end(); ++v) {
+		if (state[*v] != VarState::V_UNASSIGNED || marked(*v)) continue;
+		comp_vars.push_back(vector<Var>());
+		comp_clauses.push_back(vector<int>());
+		marked(*v) = true;
+		stack.push_back(*v);
+		while (!stack.empty()) {
+			Var u = stack.back();
+			stack.pop_back();
+			comp_vars.back().push_back(u);
+			for (vector<int>::iterator idx = occurs[u].begin(); idx != occurs[u].end(); ++idx) {
+				clause_t& c = cnf[*idx].cl();
+				if (any_of(c.begin(), c.end(), [this](Lit l) { return lit_state(l) == LitState::L_SAT; })) continue;
+				comp_clauses.back().push_back(*idx);
+				for (clause_it it = c.begin(); it != c.end(); ++it) {
+					Var w = l2v(*it);
+					if (state[w] != VarState::V_UNASSIGNED || marked(w)) continue;
+					marked(w) = true;
+					stack.push_back(w);
+				}
+			}
+		}
+		if (comp_clauses.back().empty()) { // a free variable
+			++free_vars;
+			marked(*v) = false;
+			comp_vars.pop_back();
+			comp_clauses.pop_back();
+		}
+	}
+	for (vector<vector<Var> >::iterator comp = comp_vars.begin(); comp != comp_vars.end(); ++comp)
+		for (vector<Var>::iterator v = comp->begin(); v != comp->end(); ++v) marked(*v) = false;
+	n = BigUint(1);
+	exact = true;
+	for (unsigned int i = 0; i < comp_vars.size(); ++i) {
+		BigUint m;
+		bool e;
+		if (!count_component(comp_vars[i], comp_clauses[i], m, e)) return false;
+		if (m.is_zero()) { // 0 if exact, otherwise the whole residual formula has no models
+			n = m;
+			exact = e;
+			return true;
+		}
+		n = n * m;
+		exact = exact && e;
+	}
+	n <<= free_vars;
+	return true;
+}
+
+bool Solver::count_component(vector<Var>& vars, vector<int>& clauses, BigUint& n, bool& exact) {
+	sort(vars.begin(), vars.end());
+	sort(clauses.begin(), clauses.end());
+	clauses.erase(unique(clauses.begin(), clauses.end()), clauses.end());
+	string key;
+	int prev = 0;
+	auto put = [&key, &prev](int x) { // the difference to the previous number, 7 bits per byte
+		unsigned int d = x - prev;
+		for (prev = x; d >= 128; d >>= 7) key.push_back(static_cast<char>((d & 127) | 128));
+		key.push_back(static_cast<char>(d));
+	};
+	for (vector<Var>::iterator v = vars.begin(); v != vars.end(); ++v) put(*v);
+	prev = -1; // a 0 byte separates the clauses from the variables
+	key.push_back(0);
+	for (vector<int>::iterator idx = clauses.begin(); idx != clauses.end(); ++idx) put(*idx);
+	unordered_map<string, BigUint>::iterator hit = cache.find(key);
+	if (hit != cache.end()) {
+		++num_cache_hits;
+		n = hit->second;
+		exact = true;
+		return true;
+	}
+	if (timed_out()) return false;
+	++num_components;
+	Var best = vars[0];
+	for (vector<Var>::iterator v = vars.begin(); v != vars.end(); ++v) 
+		if (m_activity[*v] > m_activity[best]) best = *v;
+	n = BigUint();
+	exact = true;
+	int level = dl;
+	for (int sign = 1; sign >= -1; sign -= 2) {
+		Lit d = v2l(sign * best);
+		if (lit_state(d) == LitState::L_UNSAT) continue; // best was set by the clause learned in the other branch
+		new_decision_level();
+		if (lit_state(d) == LitState::L_UNASSIGNED) {
+			assert_lit(d);
+			antecedent(best) = -1;
+			++num_decisions;
+		}
+		SolverState res = BCP();
+		bool learned = false; // a learned clause took part in BCP
+		for (unsigned int i = separators[dl]; i < trail.size() && !learned; ++i) {
+			int ant = antecedent(l2v(trail[i]));
+			learned = ant >= 0 && cnf[ant].is_learnt();
+		}
+		if (res == SolverState::CONFLICT) {
+			++num_conflicts;
+			unsigned int size = cnf.size();
+			analyze(cnf[conflicting_clause_idx]);
+			conflicting_clause_idx = -1;
+			backtrack_to(level);
+			// The learned clause is unit here: its literal is implied under the assignment up to level, so asserting 
+			// it prunes only non-models. It may set variables of this component (often best), so the count is not cached. 
+			assert_lit(asserted_lit);
+			antecedent(l2v(asserted_lit)) = cnf.size() > size ? static_cast<int>(cnf.size()) - 1 : -1; // -1: a unit
+			exact = false;
+			if (BCP() != SolverState::UNDEF) { // no models under level
+				conflicting_clause_idx = -1;
+				n = BigUint();
+				return true;
+			}
+			continue;
+		}
+		BigUint m;
+		bool e;
+		if (!count_residual(vars, m, e)) return false;
+		n += m;
+		exact = exact && e && !learned;
+		backtrack_to(level);
+	}
+	if (exact) cache[key] = n;
+	return true;
+}
+
+#pragma endregion counting
+
+
+/******************  main ******************************/
+#ifndef EDUSAT_LIBRARY
 int main(int argc, char** argv){
 	begin_time = cpuTime();
+	begin_wall = wallTime();
 	parse_options(argc, argv);
+	wall_timeout = num_threads > 1 || split_threads > 1;
 	
-	ifstream in (argv[argc - 1]);
-	if (!in.good()) Abort("cannot read input file", 1);	
+	string file_name = argv[argc - 1];
+	ifstream fin;
+	if (file_name != "-") {
+		fin.open(file_name);
+		if (!fin.good()) Abort("cannot read input file", 1);	
+	}
+	istream& in = (file_name == "-") ? cin : fin; // "-": stdin
 	cout << "This is edusat" << endl;
-	S.read_cnf(in);		
-	in.close();
-	S.solve();	
+	Solver S;
+	ProofWriter* proof = nullptr;
+	if (!proof_file.empty()) {
+		if (cube_depth > 0 || num_procs > 1 || num_threads > 1 || !assumptions_file.empty()) 
+			Abort("-proof cannot be combined with -cnc, -procs, -threads or -assume", 2);
+		proof = new ProofWriter(proof_file, proof_lrat != 0);
+		if (!proof->good()) Abort("cannot write proof file", 1);
+		S.set_proof(proof);
+	}
+	if (enum_models > 0 && (cube_depth > 0 || num_procs > 1 || num_threads > 1 || proof || !core_file.empty())) 
+		Abort("-enum cannot be combined with -cnc, -procs, -threads, -proof or -core", 2);
+	if (!project_file.empty() && !enum_models) Abort("-project requires -enum", 2);
+	if (backbone_chunk > 0 && (cube_depth > 0 || num_procs > 1 || num_threads > 1 || proof || !core_file.empty() || enum_models || !assumptions_file.empty())) 
+		Abort("-backbone cannot be combined with -cnc, -procs, -threads, -proof, -core, -enum or -assume", 2);
+	if (split_threads > 0 && (cube_depth > 0 || num_procs > 1 || num_threads > 1 || proof || !core_file.empty() || enum_models || backbone_chunk || count_models || !assumptions_file.empty())) 
+		Abort("-split cannot be combined with -cnc, -procs, -threads, -proof, -core, -enum, -backbone, -count or -assume", 2);
+	if (count_models && (cube_depth > 0 || num_procs > 1 || num_threads > 1 || proof || !core_file.empty() || enum_models || backbone_chunk || !assumptions_file.empty())) 
+		Abort("-count cannot be combined with -cnc, -procs, -threads, -proof, -core, -enum, -backbone or -assume", 2);
+	if (!core_file.empty()) {
+		if (cube_depth > 0 || num_procs > 1 || num_threads > 1 || !assumptions_file.empty()) 
+			Abort("-core cannot be combined with -cnc, -procs, -threads or -assume", 2);
+		S.set_core(core_file);
+	}
+	InputFormat format = S.read_cnf(in);
+	if (format != InputFormat::CNF) {
+		if (cube_depth > 0 || num_procs > 1 || num_threads > 1 || !assumptions_file.empty() || proof || !core_file.empty() || enum_models || backbone_chunk || count_models || split_threads) 
+			Abort("iCNF and WCNF input are solved by a single solver; they take no -cnc, -procs, -threads, -assume, -proof, -core, -enum, -backbone, -count or -split", 2);
+		if (format == InputFormat::ICNF) S.solve_icnf(in);
+		else S.solve_maxsat();
+		return 0;
+	}
+	if (fin.is_open()) fin.close();
+	if (renumber_vars) S.renumber();
+	if (!assumptions_file.empty()) {
+		if (cube_depth > 0) Abort("-assume cannot be combined with -cnc", 2);
+		ifstream ain(assumptions_file);
+		if (!ain.good()) Abort("cannot read assumptions file", 1);
+		S.read_assumptions(ain);
+	}
+	if (!project_file.empty()) {
+		ifstream pin(project_file);
+		if (!pin.good()) Abort("cannot read projection file", 1);
+		S.read_projection(pin);
+	}
+	if (enum_models > 0) S.enumerate(enum_models);
+	else if (backbone_chunk > 0) S.backbone(backbone_chunk);
+	else if (count_models) S.count();
+	else if (split_threads > 0) S.solve_components(split_threads);
+	else if (cube_depth > 0) solve_cubes(S, cube_depth, num_threads);
+	else if (num_procs > 1) solve_procs(S, num_procs);
+	else if (num_threads > 1) solve_portfolio(S, num_threads);
+	else S.solve();	
+	delete proof; // flushes
 
 	return 0;
 }
+#endif
@@ -14,19 +14,20 @@
 #include <cassert>
 #include <ctime>
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <climits>
+#include <chrono>
+#include <cstdint>
 #include "options.h"
+#include "literals.h"
 using namespace std;
 
-typedef int Var;
-typedef int Lit;
-typedef vector<Lit> clause_t;
-typedef clause_t::iterator clause_it;
-typedef vector<Lit> trail_t;
-
 #define Assert(exp) AssertCheck(exp, __func__, __LINE__)
 
 
-#define Neg(l) (l & 1)
 #define Restart_multiplier 1.1f
 #define Restart_lower 100
 #define Restart_upper 1000
@@ -37,10 +38,31 @@ typedef vector<Lit> trail_t;
 
 int verbose = 0;
 double begin_time;
+double begin_wall;    // wall-clock time at start (see timed_out())
 double timeout = 0.0;
 int enable_cb = 0;    // 0 = traditional NCB, 1 = chronological backtracking
 int cb_heuristic = 0; // 0 = always-CB, 1 = limited-CB, 2 = reusetrail-CB
 int cb_threshold = 100; // threshold T for limited-CB (default 100)
+int enable_simp = 1;  // 0 = off, 1 = simplify the clause DB when new level-0 units appear
+int enable_viv = 1;   // 0 = off, 1 = vivify learned clauses after restarts
+int viv_budget = 20000;  // propagation budget per vivification round, in watched clauses visited by BCP
+int num_threads = 1;  // portfolio workers
+int num_procs = 1;    // process portfolio workers
+int enable_share = 1; // 0 = off, 1 = portfolio workers exchange short learned clauses
+int share_size = 8;   // max size of a shared clause
+int share_lbd = 4;    // max LBD of a shared clause
+int cube_depth = 0;   // cube-and-conquer: max decisions per cube (0 = off)
+string assumptions_file = ""; // DIMACS literals to assume (empty = none)
+string proof_file = "";       // proof output (empty = none)
+int proof_lrat = 0;           // proof format: 0 = binary DRAT, 1 = text LRAT
+string core_file = "";        // UNSAT core output (empty = none)
+int enum_models = 0;          // model enumeration: max # of models (0 = off)
+string project_file = "";     // variables to project the enumerated models on (empty = all)
+int backbone_chunk = 0;       // backbone: max # of candidate literals tested per solve call (0 = off)
+int count_models = 0;         // 0 = off, 1 = exact model counting (#SAT)
+int split_threads = 0;        // variable-disjoint components solved separately: # of threads (0 = off)
+int renumber_vars = 0;        // 0 = off, 1 = renumber the variables for locality (Cuthill-McKee)
+int compact_vars = 0;         // 0 = off, 1 = allocate only the variables that occur in the input
 
 
 void Abort(string s, int i);
@@ -61,24 +83,55 @@ enum class VAL_DEC_HEURISTIC {
 
 VAL_DEC_HEURISTIC ValDecHeuristic = VAL_DEC_HEURISTIC::PHASESAVING;
 
+// The options that the search loop tests per literal, as compile-time constants. BCP(), analyze(), decide() and 
+// _solve() are instantiated once per combination, and Solver::_solve() picks the one matching the options. 
+// Options tested once per conflict or restart (cb_heuristic, backtracking, restart()) and the verbosity stay 
+// runtime checks: specializing them would multiply the instantiations without a measurable gain. 
+template <bool CB, VAR_DEC_HEURISTIC VarDH, VAL_DEC_HEURISTIC ValDH>
+struct SolverConfig {
+	static constexpr bool cb = CB;						// enable_cb
+	static constexpr VAR_DEC_HEURISTIC var_dh = VarDH;	// VarDecHeuristic
+	static constexpr VAL_DEC_HEURISTIC val_dh = ValDH;	// ValDecHeuristic
+};
+
 
 unordered_map<string, option*> options = {
 	{"v",           new intoption(&verbose, 0, 2, "Verbosity level")},
-	{"timeout",     new doubleoption(&timeout, 0.0, 36000.0, "Timeout in seconds")},
+	{"timeout",     new doubleoption(&timeout, 0.0, 36000.0, "Timeout in seconds (CPU time; wall-clock time with several threads)")},
 	{"valdh",       new intoption((int*)&ValDecHeuristic, 0, 1, "{0: phase-saving, 1: literal-score}")},
 	{"cb",          new intoption(&enable_cb, 0, 1, "Enable chronological backtracking (0/1)")},
 	{"cbh",         new intoption(&cb_heuristic, 0, 2, "{0: always-CB, 1: limited-CB, 2: reusetrail-CB}")},
-	{"cbt",         new intoption(&cb_threshold, 0, 1000000, "Threshold T for limited-CB (default 100)")}
+	{"cbt",         new intoption(&cb_threshold, 0, 1000000, "Threshold T for limited-CB (default 100)")},
+	{"simp",        new intoption(&enable_simp, 0, 1, "Level-0 simplification of the clause DB (0/1)")},
+	{"viv",         new intoption(&enable_viv, 0, 1, "Vivify learned clauses between restarts (0/1)")},
+	{"vivb",        new intoption(&viv_budget, 0, 100000000, "Propagation budget per vivification round (watch visits)")},
+	{"threads",     new intoption(&num_threads, 1, 256, "Portfolio of diversified solver threads")},
+	{"procs",       new intoption(&num_procs, 1, 256, "Portfolio of diversified solver processes (fork)")},
+	{"share",       new intoption(&enable_share, 0, 1, "Share learned clauses between portfolio threads (0/1)")},
+	{"sharesize",   new intoption(&share_size, 1, 64, "Max size of a shared clause")},
+	{"sharelbd",    new intoption(&share_lbd, 1, 64, "Max LBD of a shared clause")},
+	{"cnc",         new intoption(&cube_depth, 0, 30, "Cube-and-conquer with cubes of up to N decisions (0: off)")},
+	{"assume",      new stringoption(&assumptions_file, "File with literals to assume; on UNSAT the failed ones are printed")},
+	{"proof",       new stringoption(&proof_file, "Write a proof of UNSAT to this file (binary DRAT unless -lrat 1)")},
+	{"lrat",        new intoption(&proof_lrat, 0, 1, "Proof format {0: binary DRAT, 1: text LRAT with clause hints}")},
+	{"core",        new stringoption(&core_file, "On UNSAT, write an unsatisfiable subset of the input clauses to this file")},
+	{"enum",        new intoption(&enum_models, 0, 1000000000, "Enumerate up to N models, printed as they are found (0: off)")},
+	{"project",     new stringoption(&project_file, "File with the variables to project the enumerated models on")},
+	{"backbone",    new intoption(&backbone_chunk, 0, 1000000, "Compute the backbone, testing up to N candidates per solve call (0: off)")},
+	{"count",       new intoption(&count_models, 0, 1, "Count the models exactly, with component caching (0/1)")},
+	{"split",       new intoption(&split_threads, 0, 256, "Solve variable-disjoint components separately, on N threads (0: off)")},
+	{"renum",       new intoption(&renumber_vars, 0, 1, "Renumber the variables in Cuthill-McKee order, for locality (0/1)")},
+	{"compact",     new intoption(&compact_vars, 0, 1, "Allocate only the variables that occur in the input, numbered densely (0/1)")}
 };
 
 
-enum class LitState {
+enum class LitState : uint8_t {
 	L_UNSAT,
 	L_SAT,
 	L_UNASSIGNED
 };
 
-enum class VarState {
+enum class VarState : uint8_t { // one byte: state[] is read for every literal visited by BCP
 	V_FALSE,
 	V_TRUE,
 	V_UNASSIGNED
@@ -91,6 +144,12 @@ enum class ClauseState {
 	C_UNDEF
 };
 
+enum class InputFormat {
+	CNF,
+	ICNF,  // incremental: clauses and queries (`p inccnf')
+	WCNF   // weighted MaxSAT, with `p wcnf' (old) or without a header (new, `h' marks hard clauses)
+} ;
+
 enum class SolverState{
 	UNSAT,
 	SAT,
@@ -109,6 +168,9 @@ static inline double cpuTime(void) {
 
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <signal.h>
 #include <unistd.h>
 
 static inline double cpuTime(void) {
@@ -117,6 +179,18 @@ static inline double cpuTime(void) {
     return (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec / 1000000; }
 #endif
 
+static inline double wallTime(void) {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count(); }
+
+bool wall_timeout = false; // set by main() when several solver threads run
+
+// -timeout counts the CPU time of the process, or wall-clock time with several solver threads, 
+// whose CPU times add up. 
+inline bool timed_out() {
+	if (timeout <= 0) return false;
+	return (wall_timeout ? wallTime() - begin_wall : cpuTime() - begin_time) > timeout;
+}
+
 // For production wrap with #ifdef _DEBUG
 void AssertCheck(bool cond, string func_name, int line, string msg = "") {
 	if (cond) return;
@@ -127,44 +201,29 @@ void AssertCheck(bool cond, string func_name, int line, string msg = "") {
 }
 
 
-bool match(ifstream& in, char* str) {
+bool match(istream& in, const char* str) {
     for (; *str != '\0'; ++str)
         if (*str != in.get())
             return false;
     return true;
 }
 
-unsigned int Abs(int x) { // because the result is compared to an unsigned int. unsigned int are introduced by size() functions, that return size_t, which is defined to be unsigned. 
-	if (x < 0) return (unsigned int)-x;
-	else return (unsigned int)x;
-}
-
-unsigned int v2l(int i) { // maps a literal as it appears in the cnf to literal
-	if (i < 0) return ((-i) << 1) - 1; 
-	else return i << 1;
-} 
-
-Var l2v(Lit l) {
-	return (l+1) / 2;	
-} 
-
-Lit lit_negate(Lit l) {
-	if (Neg(l)) return l + 1;  // odd
-	return l - 1;		
-}
-
-int l2rl(int l) {
-	return Neg(l)? -((l + 1) / 2) : l / 2;
-}
 
 
 /********** classes ******/ 
 
+class Solver;
+
 class Clause {
 	clause_t c;
 	int lw,rw; //watches;	
+	bool learnt;  // produced by analyze()
+	bool deleted; // removed from the clause DB. The slot is kept so that clause indices stay valid.
+	bool imported; // received from another portfolio worker
+	bool used;    // took part in conflict analysis (tracked for imported clauses only)
+	int id;       // proof clause id (LRAT): input clauses are numbered 1..m in input order, derived ones after them
 public:	
-	Clause(){};
+	Clause(): learnt(false), deleted(false), imported(false), used(false), id(0) {};
 	void insert(int i) {c.push_back(i);}
 	void lw_set(int i) {lw = i; /*assert(lw != rw);*/}
 	void rw_set(int i) {rw = i; /*assert(lw != rw);*/}	
@@ -174,26 +233,82 @@ public:
 	int get_lw_lit() {return c[lw];}
 	int get_rw_lit() {return c[rw];}
 	int  lit(int i) {return c[i];} 		
-	inline ClauseState next_not_false(bool is_left_watch, Lit other_watch, bool binary, int& loc); 
+	template <class Cfg> inline ClauseState next_not_false(Solver& solver, bool is_left_watch, Lit other_watch, bool binary, int& loc); 
 	size_t size() {return c.size();}
 	void reset() { c.clear(); }	
+	bool is_learnt() {return learnt;}
+	void set_learnt() {learnt = true;}
+	bool is_imported() {return imported;}
+	void set_imported() {imported = true;}
+	int get_id() const {return id;}
+	void set_id(int i) {id = i;}
+	bool mark_used() {bool first = imported && !used; used = true; return first;} // true on the first use of an imported clause
+	bool is_deleted() {return deleted;}
+	void mark_deleted() {deleted = true; clause_t().swap(c);} // also releases the literals' memory
 	void print() {for (clause_it it = c.begin(); it != c.end(); ++it) {cout << *it << " ";}; }
-	void print_real_lits() {
-		Lit l; 
-		cout << "("; 
-		for (clause_it it = c.begin(); it != c.end(); ++it) { 
-			l = l2rl(*it); 
-			cout << l << " ";} cout << ")"; 
-	}
-	void print_with_watches() {		
-		for (clause_it it = c.begin(); it != c.end(); ++it) {
-			cout << l2rl(*it);
-			int j = distance(c.begin(), it); //also could write "int j = i - c.begin();"  : the '-' operator is overloaded to allow such things. but distance is more standard, as it works on all standard containers.
-			if (j == lw) cout << "L";
-			if (j == rw) cout << "R";
-			cout << " ";
-		};
-	}
+	void print_real_lits(Solver& solver); // in DIMACS numbering (see Solver::lit_name())
+	void print_with_watches(Solver& solver);
+};
+
+/* Lock-free multi-producer ring buffer through which portfolio workers exchange short learned clauses. 
+A producer claims a ticket with fetch_add and writes the clause into slot (ticket % Capacity), guarded 
+by a per-slot sequence number: odd while being written, 2 * ticket + 2 once published. A producer that 
+finds its slot busy, or already holding a newer ticket, drops the clause - sharing is best effort. 
+Each consumer keeps its own cursor; tickets that were dropped, or overwritten before it got to them, are 
+skipped. Only a slot that is being written for the ticket at the cursor holds the consumer back. */
+class ClauseExchange {
+public:
+	static const unsigned int Capacity = 1 << 14;
+	static const unsigned int Max_size = 64;
+	ClauseExchange() : head(0), slots(Capacity) {}
+	bool put(int producer, const clause_t& c);
+	void get(int consumer, unsigned long long& cursor, vector<clause_t>& out);
+private:
+	struct Slot {
+		atomic<unsigned long long> seq;
+		atomic<int> producer, size;
+		atomic<Lit> lits[Max_size];
+		Slot() : seq(0), producer(-1), size(0) {}
+	};
+	atomic<unsigned long long> head;
+	vector<Slot> slots;
+};
+
+/* Proof output, binary DRAT or text LRAT. 
+Binary DRAT: each line is 'a' (addition) or 'd' (deletion), the literals and a 0 byte. A literal l is written 
+as the unsigned number 2|l| + (l < 0), 7 bits per byte, low bits first, with the high bit set on all bytes but the last. 
+LRAT: an addition is "id lits 0 hints 0", where the hints are the ids of the clauses that, in this order, become 
+unit (the last one conflicting) under the negation of the new clause. A deletion is "id d ids 0". 
+Output goes through a large buffer and is written strictly sequentially, so the file may be a pipe. */
+class ProofWriter {
+public:
+	static const size_t Buffer_size = 1 << 20;
+	ProofWriter(const string& file_name, bool lrat) : out(file_name, ios::binary), lrat(lrat), last_id(0) { buf.reserve(Buffer_size + 64); }
+	~ProofWriter() { flush(); }
+	bool good() { return out.good(); }
+	bool is_lrat() { return lrat; }
+	void add(int id, const vector<int>& lits, const vector<int>& hints); // lits in DIMACS format. DRAT ignores id and hints.
+	void del(int id, const vector<int>& lits);                          // DRAT writes the lits, LRAT the id
+	void flush() { out.write(buf.data(), buf.size()); buf.clear(); out.flush(); }
+private:
+	ofstream out;
+	bool lrat;
+	int last_id;
+	vector<char> buf;
+	void binary_line(char tag, const vector<int>& lits);
+	void text_int(int i);
+};
+
+/* Unsigned integer of any size, for model counts. Base 2^32 digits, least significant first, without leading zeros. */
+class BigUint {
+	vector<uint32_t> limbs;
+public:
+	BigUint(uint32_t x = 0) { if (x) limbs.push_back(x); }
+	bool is_zero() const { return limbs.empty(); }
+	BigUint& operator+=(const BigUint& b);
+	BigUint operator*(const BigUint& b) const;
+	BigUint& operator<<=(unsigned int bits);
+	string to_string() const; // decimal
 };
 
 class Solver {
@@ -205,11 +320,41 @@ class Solver {
 	vector<vector<int> > watches;  // Lit => vector of clause indices into CNF
 	vector<VarState> state;  // current assignment
 	vector<VarState> prev_state; // for phase-saving: same as state, only that it is not reset to 0 upon backtracking. 
-	vector<int> antecedent; // var => clause index in the cnf vector. For variables that their value was assigned in BCP, this is the clause that gave this variable its value. 
-	vector<bool> marked;	// var => seen during analyze()
-	vector<int> dlevel; // var => decision level in which this variable was assigned its value. 
+	vector<LitState> lit_val; // Lit => its value under state, kept by assert_lit() and unassign(). Read by lit_state() in BCP. 
+#ifdef EDUSAT_SOA // one vector per field
+	vector<int> antecedent_v; // var => clause index in the cnf vector. For variables that their value was assigned in BCP, this is the clause that gave this variable its value. 
+	vector<bool> marked_v;	// var => seen during analyze()
+	vector<int> dlevel_v; // var => decision level in which this variable was assigned its value. 
+	int& antecedent(Var v) { return antecedent_v[v]; }
+	vector<bool>::reference marked(Var v) { return marked_v[v]; }
+	int& dlevel(Var v) { return dlevel_v[v]; }
+#else // the fields that analyze(), BCP() and the CB code read together, in one record per variable
+	struct VarInfo {
+		int antecedent; 
+		int dlevel;
+		bool marked;
+		VarInfo() : antecedent(-1), dlevel(0), marked(false) {}
+	};
+	vector<VarInfo> var_info;
+	int& antecedent(Var v) { return var_info[v].antecedent; }
+	bool& marked(Var v) { return var_info[v].marked; }
+	int& dlevel(Var v) { return var_info[v].dlevel; }
+#endif
 	vector<int> conflicts_at_dl; // decision level => # of conflicts under it. Used for local restarts. 
 	vector<Lit> decision_lits; // decision literal per decision level (index == level, index 0 unused)
+	vector<Lit> assumptions; // decided first, assumptions[i] at level i + 1
+	vector<Lit> failed_assumptions; // after UNSAT under the assumptions: a subset of them that is enough for the conflict
+	bool unsat;  // UNSAT at level 0, i.e., regardless of the assumptions
+	vector<Var> ext2int; // incremental interface: DIMACS variable => variable (0: not seen yet)
+	vector<int> int2ext; // variable => DIMACS variable (0: internal, e.g., an activation variable)
+	vector<Lit> group_acts; // activation literals of the open clause groups (push/pop), innermost last
+	vector<clause_t> soft;  // MaxSAT: soft clauses
+	vector<long long> soft_weight;
+	vector<Var> project;    // model enumeration: the projection variables, decided first (empty: all variables)
+	vector<int> unit_id;    // var => proof id of the unit clause of its level-0 literal (0: not in the proof yet)
+	int last_id;            // proof ids: the last id given to a clause
+	vector<vector<int> > occurs;            // model counting: var => indices of the input clauses it occurs in
+	unordered_map<string, BigUint> cache;   // model counting: component key => # of models
 
 	// Used by VAR_DH_MINISAT:	
 	map<double, unordered_set<Var>, greater<double>> m_Score2Vars; // 'greater' forces an order from large to small of the keys
@@ -223,7 +368,7 @@ class Solver {
 	unsigned int 
 		nvars,			// # vars
 		nclauses, 		// # clauses
-		nlits,			// # literals = 2*nvars				
+		nlits,			// # literals = 2*nvars (indices 2..nlits+1)				
 		qhead;			// index into trail. Used in BCP() to follow the propagation process.
 	int
 		num_learned,
@@ -234,6 +379,18 @@ class Solver {
 		num_propagations,       // BCP queue dequeues
 		num_cb_backtracks,      // conflicts resolved via CB
 		num_ncb_backtracks,     // conflicts resolved via NCB
+		num_vivified,           // learned clauses shortened by vivify()
+		num_viv_deleted,        // learned clauses found redundant by vivify()
+		num_viv_lits,           // literals removed by vivify()
+		viv_restart_mark,       // num_restarts at the last vivification round
+		num_root_lits,          // literals assigned at level 0 so far
+		simp_root_lits,         // num_root_lits at the last simplify()
+		num_simp_deleted,       // satisfied clauses removed by simplify()
+		num_simp_lits,          // false literals removed by simplify()
+		num_exported,           // learned clauses put in the portfolio exchange
+		num_imported,           // clauses taken from the portfolio exchange
+		num_import_used,        // imported clauses that took part in conflict analysis
+		import_restart_mark,    // num_restarts at the last import
 		dl,				// decision level
 		max_dl,			// max dl seen so far since the last restart
 		conflicting_clause_idx, // holds the index of the current conflicting clause in cnf[]. -1 if none.
@@ -242,10 +399,34 @@ class Solver {
 		restart_upper;
 
 	long long total_backtrack_distance; // sum of (c - actual_b) per conflict
+	long long num_visits;   // watched clauses visited by BCP
+	long long num_components, num_cache_hits; // model counting
+	unsigned int viv_next;  // index into cnf of the next vivification candidate
 
 	Lit 		asserted_lit;
 
 	float restart_multiplier;
+
+	// configuration. Copied from the command-line options; diversify() varies it per portfolio worker. 
+	int enable_cb, cb_heuristic, cb_threshold, enable_simp, enable_viv, viv_budget;
+	VAR_DEC_HEURISTIC VarDecHeuristic;
+	VAL_DEC_HEURISTIC ValDecHeuristic;
+	const atomic<bool>* terminate; // when set (by another thread), _solve() gives up. May be null. 
+	int (*terminate_cb)(void*);     // IPASIR termination callback, polled like 'terminate'. May be null. 
+	void* terminate_data;
+	void (*learn_cb)(void*, int*);  // IPASIR learned-clause callback. May be null. 
+	void* learn_data;
+	int learn_max;                  // max size of a clause passed to learn_cb
+	ClauseExchange* exchange; // clause sharing between portfolio workers. May be null. 
+	ProofWriter* proof;       // proof of UNSAT. May be null. 
+	bool trace;               // clauses get proof ids, and derived ones are passed to proof_add(): for a proof or a core
+	bool trace_hints;         // ... with their hints (LRAT, core)
+	string core_file;         // UNSAT core output (empty = none)
+	vector<vector<int> > derivation;    // for the core: proof id => hints of a derived clause
+	vector<vector<int> > input_clauses; // for the core: proof id - 1 => input clause in DIMACS format
+	int worker_id;
+	int share_size, share_lbd;
+	unsigned long long exchange_cursor;
 	
 	// access	
 	int get_learned() { return num_learned; }
@@ -259,25 +440,53 @@ class Solver {
 	void add_to_trail(int x) { trail.push_back(x); }
 
 	void reset(); // initialization that is invoked initially + every restart
-	void initialize();
+	void resize_var_info(unsigned int n);
+	void grow_vars(unsigned int n);
+	Var new_var(int ext);
+	Lit ext2lit(int lit);
+	int lit2ext(Lit l) { int v = int2ext[l2v(l)]; return Neg(l) ? -v : v; }
 	void reset_iterators(double activity_key = 0.0);	
 
 	// solving	
-	SolverState decide();
+	template <class Cfg> SolverState decide();
 	void test();
-	SolverState BCP();
+	template <class Cfg> SolverState BCP();
+	SolverState BCP(); // for callers outside the search loop: BCP<Cfg>() for the current options
+	template <class Cfg> int analyze(const Clause);
 	int  analyze(const Clause);
-	inline int  getVal(Var v);
+	void analyze_final(Lit p);
+	template <class Cfg> inline int getVal(Var v);
 	inline void add_clause(Clause& c, int l, int r);
 	inline void add_unary_clause(Lit l);
+	void detach_clause(int idx);
+	void remove_clause(int idx);
+	void new_decision_level();
 	inline void assert_lit(Lit l, int forced_level = -1);	
+	inline void unassign(Var v);
 	void m_rescaleScores(double& new_score);
 	inline void backtrack_ncb(int k);
 	inline void backtrack_cb(int k, int conflict_cls_blevel);
 	void backtrack_cb_preserve(int k);
+	void backtrack_to(int k);
 	int  determine_backtrack_level(int j); // j = asserting level; uses dl as c
 	int  reusetrail_backtrack_level(int j);
 	void restart();
+	int  proof_add(const clause_t& c, const vector<int>& hints);
+	void proof_delete(int id, const clause_t& c);
+	int  root_unit_id(Var v);
+	void conflict_hints(int k, const clause_t& c, vector<int>& hints);
+	void write_core(int id);
+	void add_clause_lits(const clause_t& lits);
+	long long soft_cost();
+	SolverState root_conflict();
+	SolverState vivify();
+	void simplify();
+	void export_clause(Clause& c);
+	SolverState import_clauses();
+	Var lookahead(bool& refuted);
+	void split_cubes(clause_t& cube, int depth, vector<clause_t>& cubes);
+	bool count_residual(const vector<Var>& vars, BigUint& n, bool& exact);
+	bool count_component(vector<Var>& vars, vector<int>& clauses, BigUint& n, bool& exact);
 	
 	// scores	
 	inline void bumpVarScore(int idx);
@@ -285,25 +494,69 @@ class Solver {
 
 public:
 	Solver():
-		nvars(0), nclauses(0), num_learned(0), num_decisions(0), num_assignments(0),
+		unsat(false), last_id(0), m_var_inc(1.0), nvars(0), nclauses(0), qhead(0), num_learned(0), num_decisions(0), num_assignments(0),
 		num_restarts(0), num_conflicts(0), num_propagations(0),
 		num_cb_backtracks(0), num_ncb_backtracks(0),
-		m_var_inc(1.0), total_backtrack_distance(0), qhead(0),
-		restart_threshold(Restart_lower), restart_lower(Restart_lower),
-		restart_upper(Restart_upper), restart_multiplier(Restart_multiplier)	 {};
+		num_vivified(0), num_viv_deleted(0), num_viv_lits(0), viv_restart_mark(0),
+		num_root_lits(0), simp_root_lits(0), num_simp_deleted(0), num_simp_lits(0),
+		num_exported(0), num_imported(0), num_import_used(0), import_restart_mark(0),
+		restart_threshold(Restart_lower), restart_lower(Restart_lower), restart_upper(Restart_upper), 
+		total_backtrack_distance(0), num_visits(0), num_components(0), num_cache_hits(0), viv_next(0),
+		restart_multiplier(Restart_multiplier),
+		enable_cb(::enable_cb), cb_heuristic(::cb_heuristic), cb_threshold(::cb_threshold),
+		enable_simp(::enable_simp), enable_viv(::enable_viv), viv_budget(::viv_budget),
+		VarDecHeuristic(::VarDecHeuristic), ValDecHeuristic(::ValDecHeuristic), terminate(nullptr),
+		terminate_cb(nullptr), terminate_data(nullptr), learn_cb(nullptr), learn_data(nullptr), learn_max(0),
+		exchange(nullptr), proof(nullptr), trace(false), trace_hints(false), worker_id(0), share_size(::share_size), share_lbd(::share_lbd), exchange_cursor(0) {};
 	
 	// service functions
+	// A literal in traces and messages: in DIMACS numbering, or #v for an internal variable v (e.g., an activation variable). 
+	string lit_name(Lit l) { int v = int2ext[l2v(l)]; return (Neg(l) ? "-" : "") + (v ? to_string(v) : "#" + to_string(l2v(l))); }
 	inline LitState lit_state(Lit l) {
-		VarState var_state = state[l2v(l)];
-		return var_state == VarState::V_UNASSIGNED ? LitState::L_UNASSIGNED : (Neg(l) && var_state == VarState::V_FALSE || !Neg(l) && var_state == VarState::V_TRUE) ? LitState::L_SAT : LitState::L_UNSAT;
+		return lit_val[l];
 	}
 	inline LitState lit_state(Lit l, VarState var_state) {
 		return var_state == VarState::V_UNASSIGNED ? LitState::L_UNASSIGNED : (Neg(l) && var_state == VarState::V_FALSE || !Neg(l) && var_state == VarState::V_TRUE) ? LitState::L_SAT : LitState::L_UNSAT;
 	}
-	void read_cnf(ifstream& in);
+	InputFormat read_cnf(istream& in);
+	void renumber();
+	void read_wcnf(istream& in, bool old_format);
+	void solve_maxsat();
+	void read_assumptions(ifstream& in);
+	void read_projection(ifstream& in);
+	void enumerate(int max_models);
+	void backbone(int chunk);
+	void count();
+	void solve_icnf(istream& in);
+	void initialize();
 
-	SolverState _solve();
+	template <class Cfg> SolverState _solve();
+	SolverState _solve(); // runs _solve<Cfg>() for the current options
 	void solve();
+	void report(SolverState res);
+	void diversify(int worker);
+	void set_terminate(const atomic<bool>* flag) { terminate = flag; }
+	void set_exchange(ClauseExchange* ex, int id) { exchange = ex; worker_id = id; }
+	void set_proof(ProofWriter* p) { proof = p; trace = true; trace_hints = trace_hints || p->is_lrat(); }
+	void set_core(const string& file) { core_file = file; trace = trace_hints = true; }
+	void set_assumptions(const vector<Lit>& a) { assumptions = a; }
+	bool is_unsat() { return unsat; }
+	vector<clause_t> make_cubes(int depth);
+	void solve_components(int n);
+
+	// incremental interface (IPASIR). Literals are in DIMACS format; new variables are added on the fly. 
+	void add_input_clause(const vector<int>& lits);
+	void set_input_assumptions(const vector<int>& lits);
+	int  model_value(int lit);
+	bool failed(int lit);
+	void set_terminate(void* data, int (*cb)(void*)) { terminate_data = data; terminate_cb = cb; }
+	void set_learn(void* data, int max_length, void (*cb)(void*, int*)) { learn_data = data; learn_max = max_length; learn_cb = cb; }
+	void push();
+	void pop();
+	void print_sharing_stats() {
+		cout << "Worker " << worker_id << ": exported " << num_exported << ", imported " << num_imported 
+			 << ", imports used " << num_import_used << endl;
+	}
 
 	
 	
@@ -311,38 +564,42 @@ public:
 // debugging
 	void print_cnf(){
 		for(vector<Clause>::iterator i = cnf.begin(); i != cnf.end(); ++i) {
-			i -> print_with_watches(); 
+			if (i->is_deleted()) continue;
+			i -> print_with_watches(*this); 
 			cout << endl;
 		}
 	} 
 
 	void print_real_cnf() {
 		for(vector<Clause>::iterator i = cnf.begin(); i != cnf.end(); ++i) {
-			i -> print_real_lits(); 
+			if (i->is_deleted()) continue;
+			i -> print_real_lits(*this); 
 			cout << endl;
 		}
 	} 
 
-	void print_state(const char *file_name) {
+	void print_state(const char *file_name) { // in DIMACS numbering
 		ofstream out;
 		out.open(file_name);		
 		out << "State: "; 
-		for (vector<VarState>::iterator it = state.begin() + 1; it != state.end(); ++it) {
-			char sign = (*it) == VarState::V_FALSE ? -1 : (*it) == VarState::V_TRUE ? 1 : 0;
-			out << sign * (it - state.begin()) << " "; out << endl;
+		for (unsigned int ext = 1; ext < ext2int.size(); ++ext) {
+			VarState s = ext2int[ext] ? state[ext2int[ext]] : VarState::V_UNASSIGNED;
+			char sign = s == VarState::V_FALSE ? -1 : s == VarState::V_TRUE ? 1 : 0;
+			out << sign * static_cast<int>(ext) << " "; out << endl;
 		}
 	}	
 
-	void print_state() {
+	void print_state() { // in DIMACS numbering
 		cout << "State: "; 
-		for (vector<VarState>::iterator it = state.begin() + 1; it != state.end(); ++it) {
-			char sign = (*it) == VarState::V_FALSE ? -1 : (*it) == VarState::V_TRUE ? 1 : 0;
-			cout << sign * (it - state.begin()) << " "; cout << endl;
+		for (unsigned int ext = 1; ext < ext2int.size(); ++ext) {
+			VarState s = ext2int[ext] ? state[ext2int[ext]] : VarState::V_UNASSIGNED;
+			char sign = s == VarState::V_FALSE ? -1 : s == VarState::V_TRUE ? 1 : 0;
+			cout << sign * static_cast<int>(ext) << " "; cout << endl;
 		}
 	}	
 	
 	void print_watches() {
-		for (vector<vector<int> >::iterator it = watches.begin() + 1; it != watches.end(); ++it) {
+		for (vector<vector<int> >::iterator it = watches.begin() + 2; it != watches.end(); ++it) {
 			cout << distance(watches.begin(), it) << ": ";
 			for (vector<int>::iterator it_c = (*it).begin(); it_c != (*it).end(); ++it_c) {
 				cnf[*it_c].print();
@@ -362,10 +619,22 @@ public:
 			 << "### Learned-clauses:\t" << num_learned                   << endl
 			 << "### Decisions:\t\t"     << num_decisions                 << endl
 			 << "### Implications:\t"    << num_assignments - num_decisions << endl
-			 << "### Propagations:\t"    << num_propagations              << endl;
+			 << "### Propagations:\t"    << num_propagations              << endl
+			 << "### Watch-visits:\t"   << num_visits                    << endl;
 		if (enable_cb)
 			cout << "### CB-backtracks:\t"  << num_cb_backtracks  << endl
 				 << "### NCB-backtracks:\t" << num_ncb_backtracks << endl;
+		if (enable_simp)
+			cout << "### Simp-deleted:\t"  << num_simp_deleted << endl
+				 << "### Simp-removed-lits:\t" << num_simp_lits << endl;
+		if (exchange)
+			cout << "### Exported:\t\t"    << num_exported     << endl
+				 << "### Imported:\t\t"    << num_imported     << endl
+				 << "### Imports-used:\t"  << num_import_used  << endl;
+		if (enable_viv)
+			cout << "### Vivified:\t\t"    << num_vivified     << endl
+				 << "### Viv-deleted:\t"   << num_viv_deleted  << endl
+				 << "### Viv-removed-lits:\t" << num_viv_lits  << endl;
 		cout << "### Avg-BT-distance:\t"
 			 << fixed << setprecision(2) << avg_dist              << endl
 			 << "### Time:\t\t"          << cpuTime() - begin_time << endl;
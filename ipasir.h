@@ -0,0 +1,53 @@
+/* The standard IPASIR interface for incremental SAT solvers (see the SAT Race 2015 / SAT competition
+incremental track). Literals are non-zero DIMACS integers; 0 terminates a clause.
+Implemented in edusat.cpp; build libedusat.a / libedusat.so with `make`. */
+#ifndef ipasir_h_INCLUDED
+#define ipasir_h_INCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Name and version of the solver.
+const char * ipasir_signature ();
+
+// A new solver instance, in state INPUT.
+void * ipasir_init ();
+
+// Releases the solver and all its resources.
+void ipasir_release (void * solver);
+
+// Adds a literal to the clause under construction, or finalizes it with 0. Clauses are kept across solve calls.
+void ipasir_add (void * solver, int lit_or_zero);
+
+// Assumes a literal for the next solve call only.
+void ipasir_assume (void * solver, int lit);
+
+// Solves the formula under the current assumptions. Returns 10 (SAT), 20 (UNSAT) or 0 (interrupted).
+int ipasir_solve (void * solver);
+
+// After SAT: lit if lit is true in the model, -lit if it is false, 0 if it is unassigned (don't care).
+int ipasir_val (void * solver, int lit);
+
+// After UNSAT: 1 if the assumption lit was used to derive the conflict, 0 otherwise.
+int ipasir_failed (void * solver, int lit);
+
+// The solver polls terminate(data) during search and gives up (returns 0) when it returns non-zero.
+void ipasir_set_terminate (void * solver, void * data, int (*terminate)(void * data));
+
+// learn(data, clause) is called with each learned clause of size <= max_length, as a 0-terminated array.
+void ipasir_set_learn (void * solver, void * data, int max_length, void (*learn)(void * data, int * clause));
+
+// edusat extensions (not part of IPASIR)
+
+// Opens a clause group: the clauses added until the matching edusat_pop() can be retracted together.
+void edusat_push (void * solver);
+
+// Retracts the clauses of the innermost open group, together with the learned clauses that depend on them.
+void edusat_pop (void * solver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
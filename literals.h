@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+using namespace std;
+
+// Literals, as in edusat and edusat-check (see readme.txt): DIMACS literal i is 2i, and -i is 2i+1. 
+
+typedef int Var;
+typedef int Lit;
+typedef vector<Lit> clause_t;
+typedef clause_t::iterator clause_it;
+typedef vector<Lit> trail_t;
+
+#define Neg(l) (l & 1)
+
+unsigned int Abs(int x) { // because the result is compared to an unsigned int. unsigned int are introduced by size() functions, that return size_t, which is defined to be unsigned. 
+	if (x < 0) return (unsigned int)-x;
+	else return (unsigned int)x;
+}
+
+unsigned int v2l(int i) { // maps a literal as it appears in the cnf to literal
+	if (i < 0) return ((-i) << 1) | 1; 
+	else return i << 1;
+} 
+
+Var l2v(Lit l) {
+	return l >> 1;	
+} 
+
+Lit lit_negate(Lit l) {
+	return l ^ 1; // flips the sign bit
+}
+
+int l2rl(int l) {
+	return Neg(l)? -(l >> 1) : l >> 1;
+}
@@ -44,7 +44,7 @@ extern unordered_map<string, option*> options;
 
 void help() {
 	stringstream st;
-	st << "\nUsage: edusat <options> <file name>\n \n"
+	st << "\nUsage: edusat <options> <file name>   (file name \"-\": read from stdin; `p inccnf' input is solved incrementally)\n \n"
 		"Options:\n";
 	for (auto h : options) {
 		option* opt = options[h.first];
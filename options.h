@@ -29,5 +29,11 @@ public:	doubleoption(double* p, double _lb, double _ub, string _msg) : option(_m
 	  bool parse(string st);
 	  string val() { return to_string(*p_to_var); }
 };
+class stringoption : public option {
+public:	stringoption(string* p, string _msg) : option(_msg), p_to_var(p) {}
+	  string* p_to_var; // pointer to the variable holding the option value. 
+	  bool parse(string st) { *p_to_var = st; return true; }
+	  string val() { return p_to_var->empty() ? "none" : *p_to_var; }
+};
 void Abort(string s, int i);
 void parse_options(int argc, char** argv);
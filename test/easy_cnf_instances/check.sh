@@ -89,9 +89,329 @@ run_suite() {
   echo ""
 }
 
+run_incremental() {
+  echo "=== Running iCNF queries from stdin (answers, then the failed assumptions of the UNSAT ones) ==="
+  local expected="SAT UNSAT SAT UNSAT SAT|-1|-1" got out
+  set +e
+  out="$("$SOLVER_ABS" - < incremental.icnf 2>&1)"
+  got="$(grep '^S ' <<< "$out" | cut -d' ' -f2 | xargs)"
+  # 1 is implied by the clauses of the first increment, so -1 alone fails in both UNSAT queries
+  got="$got|$(grep '^Failed assumptions:' <<< "$out" | cut -d: -f2 | xargs | tr ' ' '|')"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_enum() {
+  echo "=== Enumerating models, then projected models ==="
+  local expected="Models: 4|Models: 3" got
+  set +e
+  got="$("$SOLVER_ABS" -enum 100 enum.cnf 2>&1 | grep '^Models')|$("$SOLVER_ABS" -enum 100 -project enum.proj enum.cnf 2>&1 | grep '^Models')"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_count() {
+  echo "=== Counting models (2^96, unique model, UNSAT) ==="
+  local expected="Models: 79228162514264337593543950336|Models: 1|Models: 0" got
+  set +e
+  got="$("$SOLVER_ABS" -count 1 count.cnf 2>&1 | grep '^Models')|$("$SOLVER_ABS" -count 1 aim-50-1_6-yes1-1.cnf 2>&1 | grep '^Models')|$("$SOLVER_ABS" -count 1 aim-50-1_6-no-1.cnf 2>&1 | grep '^Models')"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_split() {
+  echo "=== Solving variable-disjoint components (SAT, UNSAT) ==="
+  local expected="S SAT|S UNSAT" got out
+  set +e
+  out="$("$SOLVER_ABS" -split 2 split.cnf 2>&1)"
+  got="$(echo "$out" | tail -1)"
+  echo "$out" | grep -q 'Assignment validated' || got="$got (not validated)"
+  got="$got|$("$SOLVER_ABS" -split 2 split-unsat.cnf 2>&1 | tail -1)"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_renum() {
+  echo "=== Renumbering the variables (the unique model, in DIMACS numbering) ==="
+  local expected="same model" got="different model" plain
+  set +e
+  "$SOLVER_ABS" aim-50-1_6-yes1-1.cnf > /dev/null 2>&1
+  plain="$(cat assignment.txt)"
+  "$SOLVER_ABS" -renum 1 aim-50-1_6-yes1-1.cnf > /dev/null 2>&1
+  [[ -n "$plain" && "$(cat assignment.txt)" == "$plain" ]] && got="same model"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_compact() {
+  echo "=== Allocating only the variables in use (count over all declared variables, the unique model) ==="
+  local expected="Models: 79228162514264337593543950336|same model" got="different model" plain
+  set +e
+  "$SOLVER_ABS" aim-50-1_6-yes1-1.cnf > /dev/null 2>&1
+  plain="$(cat assignment.txt)"
+  "$SOLVER_ABS" -compact 1 aim-50-1_6-yes1-1.cnf > /dev/null 2>&1
+  [[ -n "$plain" && "$(cat assignment.txt)" == "$plain" ]] && got="same model"
+  got="$("$SOLVER_ABS" -compact 1 -count 1 count.cnf 2>&1 | grep '^Models')|$got"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_backbone() {
+  echo "=== Computing backbones (unique model, no backbone) ==="
+  local expected="Backbone: 50 literals|Backbone: 0 literals" got
+  set +e
+  got="$("$SOLVER_ABS" -backbone 4 aim-50-1_6-yes1-1.cnf 2>&1 | grep '^Backbone')|$("$SOLVER_ABS" -backbone 1 enum.cnf 2>&1 | grep '^Backbone')"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_maxsat() {
+  echo "=== Solving MaxSAT instances (new and old WCNF format) ==="
+  local expected="o 2 s OPTIMUM FOUND|o 2 s OPTIMUM FOUND" got
+  set +e
+  got="$("$SOLVER_ABS" maxsat.wcnf 2>&1 | grep '^[os] ' | xargs)|$("$SOLVER_ABS" maxsat-old.wcnf 2>&1 | grep '^[os] ' | xargs)"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_proofs() {
+  local checker
+  checker="$(dirname "$SOLVER_ABS")/edusat-check"
+  if [[ ! -x "$checker" ]]; then
+    echo "No edusat-check next to the solver; skipping proof checks"
+    return
+  fi
+  echo "=== Checking DRAT and LRAT proofs of the UNSAT instances ==="
+  local ok=0 total=0 proof
+  proof=$(mktemp)
+  for f in aim-*no*.cnf rand3-unsat.cnf; do
+    total=$((total + 2))
+    set +e
+    "$SOLVER_ABS" -proof "$proof" "$f" > /dev/null 2>&1
+    out=$("$checker" "$f" "$proof" 2>&1 | tail -n 1)
+    "$SOLVER_ABS" -lrat 1 -proof "$proof" "$f" > /dev/null 2>&1
+    out="$out|$("$checker" -lrat "$f" "$proof" 2>&1 | tail -n 1)"
+    set -e
+    if [[ "$out" == "s VERIFIED|s VERIFIED" ]]; then
+      ok=$((ok + 2))
+    else
+      echo "  $f -> got: $out"
+    fi
+  done
+  # a truncated LRAT proof (no terminating 0 on the last line) must be rejected, not hang the checker
+  total=$((total + 1))
+  set +e
+  "$SOLVER_ABS" -lrat 1 -proof "$proof" aim-50-1_6-no-1.cnf > /dev/null 2>&1
+  out=$(head -c -3 "$proof" | timeout 10 "$checker" -lrat aim-50-1_6-no-1.cnf /dev/stdin 2>&1 | tail -n 1)
+  set -e
+  if [[ "$out" == *"truncated LRAT line"* ]]; then
+    ok=$((ok + 1))
+  else
+    echo "  truncated LRAT proof -> got: $out"
+  fi
+  rm -f "$proof"
+  echo "proofs: $ok/$total verified or rejected as expected"
+  if [[ $ok -ne $total ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_cores() {
+  echo "=== Re-solving the UNSAT cores of the UNSAT instances ==="
+  local ok=0 total=0 core
+  core=$(mktemp)
+  for f in aim-*no*.cnf rand3-unsat.cnf; do
+    total=$((total + 1))
+    set +e
+    "$SOLVER_ABS" -core "$core" "$f" > /dev/null 2>&1
+    out=$("$SOLVER_ABS" "$core" 2>&1 | tail -n 1)
+    set -e
+    if [[ "$out" =~ UNSAT ]]; then
+      ok=$((ok + 1))
+    else
+      echo "  $f -> core got: $out"
+    fi
+  done
+  rm -f "$core"
+  echo "cores: $ok/$total UNSAT"
+  if [[ $ok -ne $total ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_vivify() {
+  echo "=== Vivifying learned clauses (must shorten some, same answers as without) ==="
+  local expected="S SAT|S UNSAT|S SAT|S UNSAT" got="" out f
+  set +e
+  for f in rand3-sat.cnf rand3-unsat.cnf; do
+    out="$("$SOLVER_ABS" -viv 1 "$f" 2>&1)"
+    got="$got$(tail -1 <<< "$out")|"
+    grep -q 'Vivified:[[:space:]]*[1-9]' <<< "$out" || got="$got(nothing vivified)"
+    [[ "$f" == rand3-sat.cnf ]] && ! grep -q 'Assignment validated' <<< "$out" && got="$got(not validated)"
+  done
+  for f in rand3-sat.cnf rand3-unsat.cnf; do
+    got="$got$("$SOLVER_ABS" -viv 0 "$f" 2>&1 | tail -1)|"
+  done
+  got="${got%|}"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_simplify() {
+  echo "=== Level-0 simplification (must delete satisfied clauses, same answers as without) ==="
+  local expected="S SAT|S UNSAT|S SAT|S UNSAT" got="" out f
+  set +e
+  for f in rand3-sat.cnf rand3-unsat.cnf; do
+    out="$("$SOLVER_ABS" -simp 1 "$f" 2>&1)"
+    got="$got$(tail -1 <<< "$out")|"
+    grep -q 'Simp-deleted:[[:space:]]*[1-9]' <<< "$out" || got="$got(nothing simplified)"
+    [[ "$f" == rand3-sat.cnf ]] && ! grep -q 'Assignment validated' <<< "$out" && got="$got(not validated)"
+  done
+  for f in rand3-sat.cnf rand3-unsat.cnf; do
+    got="$got$("$SOLVER_ABS" -simp 0 "$f" 2>&1 | tail -1)|"
+  done
+  got="${got%|}"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_parallel() {
+  echo "=== Running the SAT/UNSAT instances with $* ==="
+  local ok=0 total=0 out expected
+  set +e
+  for f in aim-*.cnf rand3-sat.cnf rand3-unsat.cnf lookahead-sat.cnf; do
+    total=$((total + 1))
+    expected="S SAT"
+    [[ "$f" == *no* || "$f" == *unsat* ]] && expected="S UNSAT"
+    out="$("$SOLVER_ABS" "$@" "$f" 2>&1)"
+    if [[ "$(tail -1 <<< "$out")" == "$expected" ]] && { [[ "$expected" == "S UNSAT" ]] || grep -q 'Assignment validated' <<< "$out"; }; then
+      ok=$((ok + 1))
+    else
+      echo "  $f -> got: $(tail -1 <<< "$out")"
+    fi
+  done
+  set -e
+  echo "$*: $ok/$total"
+  if [[ $ok -ne $total ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_ipasir() {
+  local driver
+  driver="$(dirname "$SOLVER_ABS")/ipasir-test"
+  if [[ ! -x "$driver" ]]; then
+    echo "No ipasir-test next to the solver; skipping the library checks"
+    return
+  fi
+  echo "=== Solving through the IPASIR library (libedusat.a) ==="
+  local expected="ipasir: all checks passed" got
+  set +e
+  got="$("$driver" 2>&1)"
+  set -e
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
+run_assume() {
+  echo "=== Solving under assumptions (agreeing with the unique model, then contradicting it) ==="
+  local expected="S SAT|S UNSAT|failed assumptions ok|S UNSAT" got out failed lit ok assume
+  local agree="-1 2 3 -4 -5 -6 7 8 9 -10" flipped="-1 2 3 -4 5 -6 7 8 9 -10"
+  assume=$(mktemp)
+  set +e
+  echo "$agree 0" > "$assume"
+  out="$("$SOLVER_ABS" -assume "$assume" aim-50-1_6-yes1-1.cnf 2>&1)"
+  got="$(tail -1 <<< "$out")"
+  grep -q 'Assignment validated' <<< "$out" || got="$got (not validated)"
+  echo "$flipped 0" > "$assume"
+  out="$("$SOLVER_ABS" -assume "$assume" aim-50-1_6-yes1-1.cnf 2>&1)"
+  got="$got|$(tail -1 <<< "$out")"
+  # the other assumptions agree with the unique model, so 5 is in every failed set
+  failed="$(grep '^Failed assumptions:' <<< "$out" | cut -d: -f2)"
+  ok="failed assumptions ok"
+  [[ " $failed " == *" 5 "* ]] || ok="failed assumptions:$failed"
+  for lit in $failed; do
+    [[ " $flipped " == *" $lit "* ]] || ok="failed assumptions:$failed"
+  done
+  got="$got|$ok"
+  # the failed assumptions alone are contradictory
+  echo "$failed 0" > "$assume"
+  got="$got|$("$SOLVER_ABS" -assume "$assume" aim-50-1_6-yes1-1.cnf 2>&1 | tail -1)"
+  set -e
+  rm -f "$assume"
+  echo "expected: $expected | got: $got"
+  if [[ "$got" != "$expected" ]]; then
+    GLOBAL_FAIL=1
+  fi
+  echo ""
+}
+
 echo "Starting tests..."
 run_suite 0
 run_suite 1
+run_parallel -threads 4
+run_parallel -procs 3
+run_parallel -cnc 3 -threads 2
+run_incremental
+run_assume
+run_ipasir
+run_enum
+run_count
+run_split
+run_renum
+run_compact
+run_backbone
+run_maxsat
+run_proofs
+run_cores
+run_vivify
+run_simplify
 echo "Done."
 if [[ $GLOBAL_FAIL -ne 0 ]]; then
   echo "ERROR: Some tests failed." >&2
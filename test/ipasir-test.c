@@ -0,0 +1,86 @@
+/* IPASIR host used by check.sh: links libedusat.a through ipasir.h and checks the answers of ipasir_solve(),
+ipasir_val() and ipasir_failed(), that ipasir_set_terminate() interrupts the search, and that edusat_pop() 
+retracts the clauses added since the matching edusat_push().
+Built by `make ipasir-test`; prints one line per failed check and exits with 1 if there is any. */
+#include <stdio.h>
+#include "ipasir.h"
+
+/* Globals of the host with the names of solver globals: the link fails if the library exports its own. */
+int verbose = 0;
+double timeout = 0;
+int options = 0;
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { printf("FAIL line %d: %s\n", __LINE__, #cond); ++failures; } } while (0)
+
+static void add_binary(void* s, int a, int b) {
+	ipasir_add(s, a);
+	ipasir_add(s, b);
+	ipasir_add(s, 0);
+}
+
+static int terminate_calls = 0;
+
+static int terminate_when_set(void* data) {
+	++terminate_calls;
+	return *(int*)data;
+}
+
+int main() {
+	void* s = ipasir_init();
+	int stop = 1;
+	add_binary(s, -1, 2); /* 1 -> 2 -> 3 */
+	add_binary(s, -2, 3);
+	CHECK(ipasir_solve(s) == 10);
+	ipasir_assume(s, 1);
+	CHECK(ipasir_solve(s) == 10);
+	CHECK(ipasir_val(s, 1) == 1 && ipasir_val(s, 2) == 2 && ipasir_val(s, 3) == 3 && ipasir_val(s, -3) == 3);
+
+	/* 4 is not needed for the conflict */
+	ipasir_assume(s, 1);
+	ipasir_assume(s, 4);
+	ipasir_assume(s, -3);
+	CHECK(ipasir_solve(s) == 20);
+	CHECK(ipasir_failed(s, 1) && ipasir_failed(s, -3) && !ipasir_failed(s, 4));
+
+	/* assumptions hold for one call only */
+	CHECK(ipasir_solve(s) == 10);
+	ipasir_assume(s, -3);
+	CHECK(ipasir_solve(s) == 10);
+	CHECK(ipasir_val(s, 1) == -1 && ipasir_val(s, 2) == -2 && ipasir_val(s, 3) == -3);
+
+	ipasir_set_terminate(s, &stop, terminate_when_set);
+	CHECK(ipasir_solve(s) == 0 && terminate_calls > 0);
+	stop = 0;
+	CHECK(ipasir_solve(s) == 10);
+
+	/* clause groups (edusat extension): the outer one forces 1, the inner one contradicts it */
+	edusat_push(s);
+	ipasir_add(s, 1);
+	ipasir_add(s, 0);
+	edusat_push(s);
+	ipasir_add(s, -3);
+	ipasir_add(s, 0);
+	CHECK(ipasir_solve(s) == 20);
+	edusat_pop(s);
+	CHECK(ipasir_solve(s) == 10);
+	CHECK(ipasir_val(s, 1) == 1 && ipasir_val(s, 3) == 3);
+	ipasir_assume(s, -1);
+	CHECK(ipasir_solve(s) == 20 && ipasir_failed(s, -1));
+	edusat_pop(s);
+	ipasir_assume(s, -1);
+	CHECK(ipasir_solve(s) == 10);
+	CHECK(ipasir_val(s, 1) == -1);
+
+	ipasir_add(s, 1);
+	ipasir_add(s, 0);
+	ipasir_add(s, -3);
+	ipasir_add(s, 0);
+	CHECK(ipasir_solve(s) == 20);
+	ipasir_release(s);
+
+	if (failures) printf("ipasir: %d checks failed\n", failures);
+	else printf("ipasir: all checks passed\n");
+	return failures ? 1 : 0;
+}